@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Allocation Tracking Header
+ *
+ * Counts heap allocations so steady-state frames can be held to zero:
+ * - Built with TRACK_ALLOCATIONS (opt-in: cmake -DTRACK_ALLOCATIONS=ON or
+ *   make ALLOCS=1), global operator new/delete are replaced by counting
+ *   versions. C++ containers all go through them; C code calling malloc
+ *   (the GL driver, the frame arena) is not seen. Include this header from
+ *   the single translation unit of each program.
+ * - AllocZone collects what was allocated between begin() and end(), so the
+ *   sim tick and the render pass are counted separately (AllocScope does
+ *   the begin/end for a block)
+ * - AllocGuard fails loudly (message, then abort) when a zone allocates in a
+ *   frame after the warm-up; events that may allocate restart the warm-up
+ ******************************************************************************/
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+const int ALLOC_WARMUP_FRAMES = 60;
+
+// Running totals since start (zero-initialized, no constructor to wait for)
+struct HeapCounters {
+    std::atomic<unsigned int> allocations;
+    std::atomic<unsigned int> frees;
+    std::atomic<size_t> bytes;
+};
+
+inline HeapCounters& heapCounters() {
+    static HeapCounters counters;
+    return counters;
+}
+
+inline bool allocationsTracked() {
+#ifdef TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef TRACK_ALLOCATIONS
+// The operators only forward to these. Kept out of line so the compiler
+// never sees malloc/free inlined against new/delete at a call site (GCC's
+// -Wmismatched-new-delete would flag the pairing).
+#if defined(__GNUC__)
+#define ALLOC_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define ALLOC_NOINLINE __declspec(noinline)
+#else
+#define ALLOC_NOINLINE
+#endif
+
+ALLOC_NOINLINE void* trackedAllocate(size_t size) {
+    HeapCounters& c = heapCounters();
+    c.allocations++;
+    c.bytes += size;
+    return malloc(size ? size : 1);
+}
+
+ALLOC_NOINLINE void trackedRelease(void* p) {
+    if (!p) return;
+    heapCounters().frees++;
+    free(p);
+}
+
+void* operator new(size_t size) {
+    void* p = trackedAllocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    void* p = trackedAllocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return trackedAllocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete[](void* p) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    trackedRelease(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    trackedRelease(p);
+}
+#endif
+
+// ============================================================================
+// ALLOCATION ZONES
+// ============================================================================
+struct AllocZone {
+    unsigned int allocations;
+    size_t bytes;
+
+    AllocZone() : allocations(0), bytes(0), startAllocations(0), startBytes(0) {}
+
+    void reset() {
+        allocations = 0;
+        bytes = 0;
+    }
+
+    void begin() {
+        startAllocations = heapCounters().allocations;
+        startBytes = heapCounters().bytes;
+    }
+
+    // Add everything allocated since begin() (on any thread)
+    void end() {
+        allocations += heapCounters().allocations - startAllocations;
+        bytes += heapCounters().bytes - startBytes;
+    }
+
+private:
+    unsigned int startAllocations;
+    size_t startBytes;
+};
+
+class AllocScope {
+public:
+    explicit AllocScope(AllocZone& z) : zone(z) { zone.begin(); }
+    ~AllocScope() { zone.end(); }
+
+private:
+    AllocZone& zone;
+
+    AllocScope(const AllocScope&);
+    AllocScope& operator=(const AllocScope&);
+};
+
+// ============================================================================
+// STEADY-STATE GUARD
+// ============================================================================
+class AllocGuard {
+public:
+    bool enabled;
+
+    explicit AllocGuard(int warmupFrames = ALLOC_WARMUP_FRAMES)
+        : enabled(false), warmup(warmupFrames), remaining(warmupFrames), frame(0) {}
+
+    // Settings changes, new mazes and the like: let caches fill again
+    void restartWarmup() { remaining = warmup; }
+
+    bool steady() const { return remaining == 0; }
+
+    // Abort when a steady-state frame allocated in the zone
+    void check(const char* zoneName, const AllocZone& zone) const {
+        if (!enabled || !steady() || zone.allocations == 0) return;
+        fprintf(stderr, "Steady-state frame %u made %u heap allocations (%u bytes) in %s\n",
+                frame, zone.allocations, (unsigned int)zone.bytes, zoneName);
+        abort();
+    }
+
+    void nextFrame() {
+        frame++;
+        if (remaining > 0) remaining--;
+    }
+
+private:
+    int warmup;
+    int remaining;
+    unsigned int frame;
+};
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Frame Arena Header
+ *
+ * Bump allocation for data that lives for one frame:
+ * - FrameArena hands out 16-byte aligned slices of one block with an
+ *   atomic offset, so worker threads can allocate at the same time;
+ *   reset() at frame start releases everything at once
+ * - A request that does not fit goes to the heap and is counted; the next
+ *   reset() grows the block to the frame's high-water mark, so a steady
+ *   state frame makes no heap allocations at all
+ * - ArenaList<T>: push-only list of plain data in the frame arena. A list
+ *   kept across frames (a member) notices the reset and starts empty.
+ * frameArena() is the shared per-frame arena.
+ ******************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+const size_t ARENA_ALIGN = 16;
+const size_t ARENA_INITIAL_BYTES = 256 * 1024;
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t bytes = ARENA_INITIAL_BYTES)
+        : block(NULL), capacity(0), top(0), overflowBytes(0), heapCount(0), resets(0) {
+        grow(bytes);
+    }
+
+    ~FrameArena() {
+        releaseOverflow();
+        free(block);
+    }
+
+    void* allocate(size_t bytes) {
+        size_t size = (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+        size_t offset = top.fetch_add(size);
+        if (offset + size <= capacity) return block + offset;
+        return allocateOverflow(size);
+    }
+
+    // Drop every allocation; grow first if the last frame overflowed
+    void reset() {
+        size_t used = top.load();
+        heapCount = 0;
+        if (used > capacity) {
+            releaseOverflow();
+            grow(std::max(used, capacity * 2));
+        }
+        top = 0;
+        resets++;
+    }
+
+    // Bumped by reset(); lists compare it to spot stale storage
+    unsigned int generation() const { return resets; }
+
+    size_t bytesUsed() const { return std::min(top.load(), capacity) + overflowBytes; }
+    size_t blockBytes() const { return capacity; }
+
+    // Heap allocations since the last reset (overflow and growth)
+    unsigned int heapAllocations() const { return heapCount; }
+
+private:
+    char* block;
+    size_t capacity;
+    std::atomic<size_t> top;            // May pass capacity: then it is the demand
+    std::vector<void*> overflow;        // Heap slices, freed on reset
+    size_t overflowBytes;
+    std::atomic<unsigned int> heapCount;
+    unsigned int resets;
+    std::mutex overflowMutex;
+
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    void grow(size_t bytes) {
+        free(block);
+        capacity = (bytes + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+        block = static_cast<char*>(malloc(capacity));
+        if (!block) throw std::bad_alloc();
+        heapCount++;
+    }
+
+    void* allocateOverflow(size_t size) {
+        void* p = malloc(size);
+        if (!p) throw std::bad_alloc();
+        std::lock_guard<std::mutex> lock(overflowMutex);
+        overflow.push_back(p);
+        overflowBytes += size;
+        heapCount++;
+        return p;
+    }
+
+    void releaseOverflow() {
+        for (size_t i = 0; i < overflow.size(); i++) free(overflow[i]);
+        overflow.clear();
+        overflowBytes = 0;
+    }
+};
+
+inline FrameArena& frameArena() {
+    static FrameArena arena;
+    return arena;
+}
+
+// ============================================================================
+// ARENA LIST
+// For plain data only: items are copied on growth and never destroyed.
+// One writer at a time; different lists may grow on different threads.
+// ============================================================================
+template <typename T>
+class ArenaList {
+public:
+    explicit ArenaList(FrameArena* source = &frameArena())
+        : arena(source), items(NULL), count(0), capacity(0), generation(source->generation()) {}
+
+    int size() const { return valid() ? count : 0; }
+    bool empty() const { return size() == 0; }
+
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
+
+    T* begin() { return valid() ? items : NULL; }
+    T* end() { return valid() ? items + count : NULL; }
+    const T* begin() const { return valid() ? items : NULL; }
+    const T* end() const { return valid() ? items + count : NULL; }
+
+    void clear() {
+        refresh();
+        count = 0;
+    }
+
+    void push_back(const T& item) {
+        refresh();
+        if (count == capacity) reserve(capacity ? capacity * 2 : 16);
+        new (items + count) T(item);
+        count++;
+    }
+
+    void reserve(int n) {
+        refresh();
+        if (n <= capacity) return;
+        T* bigger = static_cast<T*>(arena->allocate(sizeof(T) * n));
+        if (count) memcpy(static_cast<void*>(bigger), items, sizeof(T) * count);
+        items = bigger;
+        capacity = n;
+    }
+
+private:
+    FrameArena* arena;
+    T* items;
+    int count;
+    int capacity;
+    unsigned int generation;        // Arena generation items belong to
+
+    bool valid() const { return generation == arena->generation(); }
+
+    // Storage from an earlier frame is gone: start over
+    void refresh() {
+        if (valid()) return;
+        items = NULL;
+        count = capacity = 0;
+        generation = arena->generation();
+    }
+};
+
+#endif // ARENA_H
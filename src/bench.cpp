@@ -0,0 +1,601 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Benchmark Suite
+ *
+ * Headless benchmarks for the engine's hot paths. Each section prints a
+ * small table so results from two builds can be compared side by side.
+ *
+ * Usage: ShiftingMazeBench [--size N] [--file-size N] [--light-grid N]
+ *                          [--frames N] [--threads N] [--gl] [--assert-no-alloc]
+ *   --size N        Maze edge length in cells for generator runs (default 2001)
+ *   --file-size N   Maze edge length for the .smaz file runs (default 16385)
+ *   --light-grid N  Edge length of the many-torches light grid (default 128)
+ *   --frames N      Frames per render backend (default 200)
+ *   --threads N     Worker threads for the software renderer, caller
+ *                   included; scaling is measured from 1 up to N
+ *                   (default: one per hardware thread)
+ *   --gl            Also run the GL backends (opens a window; needs a display)
+ *   --assert-no-alloc  Abort when a render frame allocates after warm-up
+ *                      (needs a TRACK_ALLOCATIONS build)
+ ******************************************************************************/
+
+#include "config.h"
+#include "generators.h"
+#include "mazefile.h"
+#include "maze.h"
+#include "renderbackend.h"
+#include "arena.h"
+#include "allocstats.h"
+#include "fasttrig.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// TIMING
+// ============================================================================
+typedef std::chrono::steady_clock BenchClock;
+
+inline double elapsedMs(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// Discards rows; keeps a checksum so the work cannot be optimized away
+class NullRowSink : public MazeRowSink {
+public:
+    uint64_t checksum;
+    int width;
+
+    NullRowSink() : checksum(0), width(0) {}
+
+    void beginMaze(int w, int h) { (void)h; width = w; }
+
+    void writeRow(int z, const uint64_t* row) {
+        int words = BitGrid::strideFor(width);
+        for (int i = 0; i < words; i++) checksum ^= row[i] + (uint64_t)z;
+    }
+};
+
+// ============================================================================
+// MAZE GENERATORS
+// ============================================================================
+void benchGenerators(int size) {
+    printf("\n== Maze generators (%d x %d cells) ==\n", size, size);
+    printf("%-12s %10s %12s %10s %12s %14s\n",
+           "generator", "grid ms", "Mcells/s", "rows ms", "Mcells/s", "row memory");
+
+    double cells = (double)size * size;
+    int count;
+    MazeGenerator* const* generators = getGenerators(count);
+
+    for (int i = 0; i < count; i++) {
+        MazeGenerator* gen = generators[i];
+        srand(12345);
+
+        BitGrid grid;
+        grid.resize(size, size);
+        BenchClock::time_point start = BenchClock::now();
+        gen->generate(grid);
+        double gridMs = elapsedMs(start);
+
+        NullRowSink sink;
+        srand(12345);
+        start = BenchClock::now();
+        gen->generateRows(size, size, sink);
+        double rowsMs = elapsedMs(start);
+
+        printf("%-12s %10.1f %12.1f %10.1f %12.1f %14s\n",
+               gen->name(),
+               gridMs, cells / (gridMs * 1000.0),
+               rowsMs, cells / (rowsMs * 1000.0),
+               gen->isStreaming() ? "O(width)" : "full grid");
+    }
+}
+
+// ============================================================================
+// MAZE FILES
+// Stream an Eller maze straight to disk, then time mapping it back.
+// ============================================================================
+void benchMazeFile(int size) {
+    const char* path = "bench_maze.smaz";
+    printf("\n== Maze file (%d x %d cells) ==\n", size, size);
+
+    EllerGenerator eller;
+    MazeFileWriter writer;
+    srand(12345);
+    BenchClock::time_point start = BenchClock::now();
+    if (!writer.open(path)) {
+        printf("cannot write %s\n", path);
+        return;
+    }
+    eller.generateRows(size, size, writer);
+    bool written = writer.finish();
+    double writeMs = elapsedMs(start);
+    if (!written) {
+        printf("write failed\n");
+        return;
+    }
+
+    start = BenchClock::now();
+    MappedMazeFile file;
+    bool opened = file.open(path);
+    double openMs = elapsedMs(start);
+    if (!opened) return;
+
+    BitGrid walls;
+    walls.attach(file.gridWords(), size, size);
+    start = BenchClock::now();
+    int open = walls.countOpen();
+    double scanMs = elapsedMs(start);
+
+    // Regenerating in memory for comparison
+    BitGrid regen;
+    regen.resize(size, size);
+    srand(12345);
+    start = BenchClock::now();
+    eller.generate(regen);
+    double regenMs = elapsedMs(start);
+
+    printf("%-28s %10.1f ms\n", "stream generate + write", writeMs);
+    printf("%-28s %10.3f ms\n", "mmap open + validate", openMs);
+    printf("%-28s %10.1f ms  (%d open cells)\n", "first full scan (popcount)", scanMs, open);
+    printf("%-28s %10.1f ms\n", "regenerate in memory", regenMs);
+    printf("%-28s %10s\n", "identical to regeneration",
+           memcmp(regen.data(), walls.data(), regen.byteCount()) == 0 ? "yes" : "NO");
+
+    file.close();
+    remove(path);
+}
+
+// ============================================================================
+// TRIGONOMETRY
+// sin/cos pairs as the camera and the tessellators ask for them, libm
+// against fasttrig.h. Error is the largest absolute difference to libm in
+// double precision.
+// ============================================================================
+volatile float trigSink;
+
+struct LibmSinCos {
+    void operator()(float x, float& s, float& c) const {
+        s = std::sin(x);
+        c = std::cos(x);
+    }
+};
+
+struct FastSinCos {
+    void operator()(float x, float& s, float& c) const { fastSinCos(x, s, c); }
+};
+
+// Ring steps the way the tessellators used to: angle from the step, then libm
+struct LibmRing {
+    void operator()(int i, int steps, float& s, float& c) const {
+        float theta = (float)i / steps * 2.0f * TRIG_PI;
+        s = std::sin(theta);
+        c = std::cos(theta);
+    }
+};
+
+struct TableRing {
+    void operator()(int i, int steps, float& s, float& c) const { circleSinCos(i, steps, s, c); }
+};
+
+template <typename F>
+double sinCosNs(const std::vector<float>& angles, int rounds, F f) {
+    float sum = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < angles.size(); i++) {
+            float s, c;
+            f(angles[i], s, c);
+            sum += s + c;
+        }
+    }
+    double ms = elapsedMs(start);
+    trigSink = sum;
+    return ms * 1e6 / ((double)angles.size() * rounds);
+}
+
+template <typename F>
+double sinCosError(const std::vector<float>& angles, F f) {
+    double worst = 0;
+    for (size_t i = 0; i < angles.size(); i++) {
+        float s, c;
+        f(angles[i], s, c);
+        double x = angles[i];
+        worst = std::max(worst, std::max(fabs(s - sin(x)), fabs(c - cos(x))));
+    }
+    return worst;
+}
+
+template <typename F>
+double ringNs(int steps, int pairs, F f) {
+    float sum = 0;
+    BenchClock::time_point start = BenchClock::now();
+    for (int done = 0; done < pairs; done += steps + 1) {
+        for (int i = 0; i <= steps; i++) {
+            float s, c;
+            f(i, steps, s, c);
+            sum += s + c;
+        }
+    }
+    double ms = elapsedMs(start);
+    trigSink = sum;
+    return ms * 1e6 / pairs;
+}
+
+template <typename F>
+double ringError(int steps, F f) {
+    double worst = 0;
+    for (int i = 0; i <= steps; i++) {
+        float s, c;
+        f(i, steps, s, c);
+        double x = 2.0 * 3.14159265358979323846 * i / steps;
+        worst = std::max(worst, std::max(fabs(s - sin(x)), fabs(c - cos(x))));
+    }
+    return worst;
+}
+
+void benchTrig() {
+    const int count = 1 << 20;
+    const int rounds = 8;
+    volatile int ringSteps = 12;    // Cylinder slices at full detail (not folded)
+
+    // Camera-sized angles, and angles after a long session of turning
+    std::vector<float> small(count), large(count);
+    srand(12345);
+    for (int i = 0; i < count; i++) {
+        float u = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        small[i] = u * 2.0f * TRIG_PI;
+        large[i] = u * 1e4f;
+    }
+
+    printf("\n== Trigonometry (%d sin/cos pairs) ==\n", count * rounds);
+    printf("%-24s %10s %14s %14s\n", "method", "ns/pair", "err |x|<=2pi", "err |x|<=1e4");
+    printf("%-24s %10.2f %14.2e %14.2e\n", "std::sin + std::cos",
+           sinCosNs(small, rounds, LibmSinCos()),
+           sinCosError(small, LibmSinCos()), sinCosError(large, LibmSinCos()));
+    printf("%-24s %10.2f %14.2e %14.2e\n", "fastSinCos",
+           sinCosNs(small, rounds, FastSinCos()),
+           sinCosError(small, FastSinCos()), sinCosError(large, FastSinCos()));
+    printf("%-24s %10.2f %14.2e\n", "ring, libm (12 steps)",
+           ringNs(ringSteps, count * rounds, LibmRing()), ringError(ringSteps, LibmRing()));
+    printf("%-24s %10.2f %14.2e\n", "ring, table (12 steps)",
+           ringNs(ringSteps, count * rounds, TableRing()), ringError(ringSteps, TableRing()));
+}
+
+// ============================================================================
+// LIGHT GRID
+// Torches scattered over a large open grid, lit floor points sampled at
+// random. Once cells hold LIGHTS_PER_CELL lights the cost per vertex stops
+// growing with the light count.
+// ============================================================================
+volatile float lightSink;
+
+void benchLightGrid(int size) {
+    const int points = 1 << 18;
+    const int counts[] = { 128, 512, 2048, 8192, 32768 };
+
+    std::vector<Vec4> samples(points);
+    srand(777);
+    for (int i = 0; i < points; i++) {
+        samples[i] = Vec4((float)rand() / RAND_MAX * size, 0.0f, (float)rand() / RAND_MAX * size);
+    }
+    Light primary;
+    primary.position = Vec4(size * 0.5f, 1.5f, size * 0.5f);
+    Material floor;
+    Vec4 up(0, 1, 0), eye(size * 0.5f, 1.6f, size * 0.5f);
+
+    printf("\n== Light grid (%d x %d cells, %d points, at most %d lights per cell) ==\n",
+           size, size, points, LIGHTS_PER_CELL);
+    printf("%-8s %10s %12s %14s\n", "lights", "build ms", "ns/vertex", "lights/vertex");
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        std::vector<Light> torches;
+        for (int i = 0; i < counts[c]; i++) {
+            Vec4 flame((rand() % size) + 0.5f, Config::TORCH_HEIGHT, (rand() % size) + 0.5f);
+            torches.push_back(torchLight(flame));
+        }
+
+        LightGrid grid;
+        BenchClock::time_point start = BenchClock::now();
+        grid.build(torches, size, size, 1.0f, Vec4(0, 0, 0));
+        double buildMs = elapsedMs(start);
+
+        LightSet lights(primary, &grid, NULL);
+        frameCounters().reset();
+        float sum = 0;
+        start = BenchClock::now();
+        for (int i = 0; i < points; i++) {
+            Color col = calculateLighting(samples[i], up, eye, lights, floor);
+            sum += col.r;
+        }
+        double ns = elapsedMs(start) * 1e6 / points;
+        lightSink = sum;
+
+        // Less one evaluation per point for the primary light
+        double perVertex = (double)frameCounters().lightingEvals / points - 1.0;
+        printf("%-8d %10.2f %12.1f %14.2f\n", counts[c], buildMs, ns, perVertex);
+    }
+}
+
+// ============================================================================
+// RENDER BACKENDS
+// One fixed scene (walls, floor, torches, spiked monsters, the Bezier path,
+// player light with shadows) submitted to each backend in turn.
+// ============================================================================
+struct BenchScene {
+    Maze maze;
+    Light playerLight;
+    LightGrid torches;
+    ShadowMask shadow;
+    MaterialTable materials;
+    int floorMaterial, wallMaterial, torchMaterial, monsterMaterial, spikeMaterial;
+    std::vector<Vec4> monsters;
+    std::vector<Vec4> curve;
+    FrameSetup frame;
+
+    BenchScene() {
+        srand(12345);
+        maze.generate(*findGenerator("backtracker"), 12345);
+
+        Material wall;
+        wall.ambient = Color(0.2f, 0.2f, 0.2f);
+        wall.diffuse = Color(0.6f, 0.5f, 0.4f);
+        wall.specular = Color(0.1f, 0.1f, 0.1f);
+        wall.shininess = 10.0f;
+        Material floor = wall;
+        floor.diffuse = Color(0.4f, 0.5f, 0.4f);
+        Material torch = wall;
+        torch.ambient = Color(1.0f, 0.6f, 0.2f);
+        Material monster = wall;
+        monster.diffuse = Color(1.0f, 0.0f, 0.0f);
+        Material spike = wall;
+        spike.diffuse = Color(1.0f, 1.0f, 0.0f);
+        floorMaterial = materials.intern(floor);
+        wallMaterial = materials.intern(wall);
+        torchMaterial = materials.intern(torch);
+        monsterMaterial = materials.intern(monster);
+        spikeMaterial = materials.intern(spike);
+
+        // Torches and monsters spread over the open cells in cell order
+        std::vector<Vec4> open;
+        for (int z = 1; z < Maze::SIZE - 1; z++) {
+            for (int x = 1; x < Maze::SIZE - 1; x++) {
+                if (maze.getCell(x, z) == CELL_EMPTY) open.push_back(maze.gridToWorld(x, z));
+            }
+        }
+        std::vector<Light> lights;
+        for (int i = 0; i < Config::TORCH_COUNT && !open.empty(); i++) {
+            Vec4 flame = open[i * open.size() / Config::TORCH_COUNT];
+            flame.y = Config::TORCH_HEIGHT;
+            lights.push_back(torchLight(flame));
+        }
+        torches.build(lights, Maze::SIZE, Maze::SIZE, maze.cellSize, maze.offset);
+        for (int i = 0; i < 8 && !open.empty(); i++) {
+            Vec4 p = open[(i * 7 + 3) % open.size()];
+            monsters.push_back(Vec4(p.x, 0.5f, p.z));
+        }
+
+        // The game's path above the maze, control points at rest
+        const int segments = 50;
+        for (int i = 0; i <= segments; i++) {
+            curve.push_back(bezierPoint(Vec4(0, 5, 0), Vec4(5, 8, 5), Vec4(10, 4, -5), Vec4(15, 6, 0),
+                                        (float)i / segments));
+        }
+
+        // Player light at the start; camera above a corner looking at the centre
+        Vec4 start = maze.getStartPosition();
+        start.y = Config::PLAYER_HEIGHT;
+        Vec4 eye(maze.offset.x - 2.0f, 9.0f, maze.offset.z - 2.0f);
+        Vec4 target(0, 0, 0);
+        playerLight.position = start;
+        playerLight.ambient = Color(0.1f, 0.1f, 0.1f);
+        playerLight.diffuse = Color(0.8f, 0.7f, 0.6f);
+        playerLight.linearAtt = 0.1f;
+        playerLight.quadraticAtt = 0.02f;
+        shadow.update(maze.walls, maze.offset, maze.cellSize, start, playerLight.range(LIGHT_CUTOFF));
+
+        frame.projection = createPerspectiveMatrix(Config::FOV,
+            (float)Config::WINDOW_WIDTH / Config::WINDOW_HEIGHT, Config::NEAR_PLANE, Config::FAR_PLANE);
+        frame.view = createLookAtMatrix(eye, target, Vec4(0, 1, 0));
+        frame.viewPos = eye;
+        frame.lights = LightSet(playerLight, &torches, &shadow);
+        frame.width = Config::WINDOW_WIDTH;
+        frame.height = Config::WINDOW_HEIGHT;
+        frame.clearColor = Color(Config::SKY_COLOR[0], Config::SKY_COLOR[1], Config::SKY_COLOR[2]);
+        frame.fogColor = frame.clearColor;
+        frame.fogDensity = Config::FOG_DENSITY;
+    }
+
+    void submit(RenderBackend& backend) const {
+        for (int z = 0; z < Maze::SIZE; z++) {
+            for (int x = 0; x < Maze::SIZE; x++) {
+                Vec4 c = maze.gridToWorld(x, z);
+                if (maze.getCell(x, z) == CELL_WALL) {
+                    backend.pushCube(wallMaterial,
+                                     createTranslationMatrix(c.x, Config::WALL_HEIGHT / 2, c.z) *
+                                     createScaleMatrix(maze.cellSize, Config::WALL_HEIGHT, maze.cellSize));
+                } else {
+                    backend.submit(floorMaterial, MESH_QUAD, createTranslationMatrix(c.x, 0, c.z) *
+                                   createScaleMatrix(maze.cellSize, 1.0f, maze.cellSize));
+                }
+            }
+        }
+        for (int i = 0; i < torches.lightCount(); i++) {
+            const Vec4& p = torches.light(i).position;
+            backend.pushCube(torchMaterial,
+                             createTranslationMatrix(p.x, p.y, p.z) * createScaleMatrix(0.15f, 0.15f, 0.15f));
+        }
+        for (size_t i = 0; i < monsters.size(); i++) {
+            const Vec4& p = monsters[i];
+            Matrix4x4 body = createTranslationMatrix(p.x, p.y, p.z) * createScaleMatrix(0.3f, 0.3f, 0.3f);
+            backend.submit(monsterMaterial, MESH_SPHERE, body, 1.0f, 0, 0);
+            for (int k = 0; k < 8; k++) {
+                Matrix4x4 spike = createRotationYMatrix(k * 45.0f * 3.14159f / 180.0f) *
+                                  createTranslationMatrix(0.8f, 0, 0) *
+                                  createRotationZMatrix(-90.0f * 3.14159f / 180.0f);
+                backend.submit(spikeMaterial, MESH_CONE, body * spike, 0.3f, 0.6f, 0);
+            }
+        }
+        backend.drawLines(&curve[0], (int)curve.size(), Color(0.5f, 0.0f, 1.0f), 3.0f);
+    }
+};
+
+void benchRenderBackends(int frames, int threads, bool withGL, bool assertNoAlloc, int& argc, char** argv) {
+    printf("\n== Render backends (%d x %d, %d frames) ==\n",
+           Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT, frames);
+
+    if (withGL) {
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+        glutInitWindowSize(Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT);
+        glutCreateWindow("ShiftingMazeBench");
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_FOG);
+        glFogi(GL_FOG_MODE, GL_EXP);
+    }
+
+    BenchScene scene;
+    WorkerPool workers(threads);
+    RenderBackends backends(&scene.materials, &workers);
+    backends.software.present = false;
+
+    printf("%-10s %10s %8s %8s %8s %10s %14s %9s %10s %12s\n", "backend", "ms/frame", "fps",
+           "items", "batches", "vertices", "lighting evals", "arena KB", "overflows", "heap allocs");
+    for (int b = 0; b < RenderBackends::count(); b++) {
+        RenderBackend& backend = *backends.get(b);
+        if (!withGL && &backend != &backends.software) {
+            printf("%-10s %10s\n", backend.name(), "(--gl)");
+            continue;
+        }
+
+        // Allocations after the warm-up (mesh caches fill, the arena grows,
+        // the GL driver compiles its state) should stay at zero
+        AllocGuard guard(std::min(ALLOC_WARMUP_FRAMES, frames / 2));
+        guard.enabled = assertNoAlloc;
+        unsigned int steadyAllocs = 0;
+        unsigned int steadyOverflows = 0;
+        BenchClock::time_point start = BenchClock::now();
+        for (int i = 0; i < frames; i++) {
+            AllocZone frame;
+            frame.begin();
+            frameCounters().reset();
+            frameArena().reset();
+            backend.beginFrame(scene.frame);
+            scene.submit(backend);
+            backend.endFrame();
+            if (withGL) glFinish();
+            frame.end();
+
+            guard.check(backend.name(), frame);
+            if (guard.steady()) {
+                steadyOverflows += frameArena().heapAllocations();
+                steadyAllocs += frame.allocations;
+            }
+            guard.nextFrame();
+        }
+        double ms = elapsedMs(start) / frames;
+        const FrameCounters& counters = frameCounters();
+
+        char allocs[16];
+        if (allocationsTracked()) {
+            snprintf(allocs, sizeof(allocs), "%u", steadyAllocs);
+        } else {
+            snprintf(allocs, sizeof(allocs), "-");
+        }
+
+        printf("%-10s %10.2f %8.1f %8d %8d %10u %14u %9u %10u %12s\n", backend.name(), ms, 1000.0 / ms,
+               backend.itemCount, backend.batchCount, counters.vertices, counters.lightingEvals,
+               (unsigned int)(frameArena().bytesUsed() / 1024), steadyOverflows, allocs);
+    }
+    printf("software: %d threads, %d triangles, %d after clipping\n", workers.threadCount(),
+           backends.software.raster.trianglesSubmitted, backends.software.raster.trianglesBinned);
+}
+
+// Software renderer frame time by thread count. Sorting, lighting and
+// binning ("queue") run partly serial; the tile raster is fully parallel.
+void benchSoftwareScaling(int frames, int maxThreads) {
+    if (maxThreads <= 0) maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    printf("\n== Software renderer scaling (%d x %d, %d frames, %u hardware threads) ==\n",
+           Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT, frames, std::thread::hardware_concurrency());
+    printf("%-8s %10s %8s %10s %10s %8s\n", "threads", "ms/frame", "fps", "queue ms", "raster ms", "speedup");
+
+    BenchScene scene;
+    double singleMs = 0;
+    // 1, 2, 4, ... and maxThreads
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        WorkerPool workers(threads);
+        SoftwareBackend software(&scene.materials, &workers);
+        software.present = false;
+
+        // Warm-up: mesh cache, framebuffer, bins
+        int warmup = std::min(10, frames);
+        double queueMs = 0, rasterMs = 0;
+        BenchClock::time_point start;
+        for (int i = 0; i < warmup + frames; i++) {
+            if (i == warmup) start = BenchClock::now();
+            frameCounters().reset();
+            frameArena().reset();
+            software.beginFrame(scene.frame);
+            scene.submit(software);
+            software.endFrame();
+            if (i >= warmup) {
+                queueMs += software.queueMs;
+                rasterMs += software.rasterMs;
+            }
+        }
+        double ms = elapsedMs(start) / frames;
+        if (threads == 1) singleMs = ms;
+        printf("%-8d %10.2f %8.1f %10.2f %10.2f %7.2fx\n", threads, ms, 1000.0 / ms,
+               queueMs / frames, rasterMs / frames, singleMs / ms);
+        if (threads == maxThreads) break;
+    }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+int main(int argc, char** argv) {
+    int size = 2001;
+    int fileSize = 16385;
+    int frames = 200;
+    int lightGridSize = 128;
+    int threads = 0;
+    bool withGL = false;
+    bool assertNoAlloc = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = atoi(argv[++i]) | 1;  // Odd sizes close the last row/column
+        } else if (strcmp(argv[i], "--file-size") == 0 && i + 1 < argc) {
+            fileSize = atoi(argv[++i]) | 1;
+        } else if (strcmp(argv[i], "--light-grid") == 0 && i + 1 < argc) {
+            lightGridSize = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--gl") == 0) {
+            withGL = true;
+        } else if (strcmp(argv[i], "--assert-no-alloc") == 0) {
+            assertNoAlloc = true;
+            if (!allocationsTracked()) printf("Built without TRACK_ALLOCATIONS, --assert-no-alloc does nothing\n");
+        }
+    }
+
+    printf("THE SHIFTING MAZE - Benchmarks\n");
+
+    benchGenerators(size);
+    benchMazeFile(fileSize);
+    benchTrig();
+    benchLightGrid(lightGridSize);
+    benchRenderBackends(frames, threads, withGL, assertNoAlloc, argc, argv);
+    benchSoftwareScaling(frames, threads);
+
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Bit Grid Header
+ *
+ * Bit-packed wall occupancy grid:
+ * - One bit per cell (1 = wall, 0 = open), row-major
+ * - Each row is padded to a whole number of 64-bit words
+ * - Word-parallel queries: popcount, find-next-open, row span tests
+ ******************************************************************************/
+
+#ifndef BITGRID_H
+#define BITGRID_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// ============================================================================
+// WORD HELPERS
+// ============================================================================
+
+inline int popCount64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit (v must not be 0)
+inline int lowestBit64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(v);
+#else
+    int n = 0;
+    while (!(v & 1)) { v >>= 1; n++; }
+    return n;
+#endif
+}
+
+// Mask with bits [from, to] set (0 <= from <= to < 64)
+inline uint64_t bitSpanMask(int from, int to) {
+    uint64_t high = (to == 63) ? ~0ULL : ((1ULL << (to + 1)) - 1);
+    return high & ~((1ULL << from) - 1);
+}
+
+// ============================================================================
+// BIT GRID CLASS
+// Cell (x, z) lives in row z, bit x. Storage is either owned or borrowed
+// (e.g. a memory-mapped file), so the same queries work on both.
+// ============================================================================
+class BitGrid {
+public:
+    int width, height;
+    int wordsPerRow;
+
+    BitGrid() : width(0), height(0), wordsPerRow(0), words(NULL) {}
+
+    BitGrid(const BitGrid& other) : words(NULL) { copyFrom(other); }
+
+    BitGrid& operator=(const BitGrid& other) {
+        if (this != &other) copyFrom(other);
+        return *this;
+    }
+
+    static int strideFor(int w) { return (w + 63) / 64; }
+
+    // Allocate owned storage; every cell starts as a wall
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        wordsPerRow = strideFor(w);
+        storage.assign((size_t)wordsPerRow * h, 0);
+        words = storage.empty() ? NULL : &storage[0];
+        fill(true);
+    }
+
+    // Borrow external storage laid out with the same row padding
+    void attach(uint64_t* data, int w, int h) {
+        storage.clear();
+        width = w;
+        height = h;
+        wordsPerRow = strideFor(w);
+        words = data;
+    }
+
+    bool isBorrowed() const { return words != NULL && storage.empty(); }
+
+    uint64_t* data() { return words; }
+    const uint64_t* data() const { return words; }
+    size_t wordCount() const { return (size_t)wordsPerRow * height; }
+    size_t byteCount() const { return wordCount() * sizeof(uint64_t); }
+
+    uint64_t* row(int z) { return words + (size_t)z * wordsPerRow; }
+    const uint64_t* row(int z) const { return words + (size_t)z * wordsPerRow; }
+
+    // ========================================================================
+    // CELL ACCESS
+    // ========================================================================
+    bool inBounds(int x, int z) const {
+        return x >= 0 && x < width && z >= 0 && z < height;
+    }
+
+    // Out-of-range cells read as walls, matching Maze::getCell
+    bool isWall(int x, int z) const {
+        if (!inBounds(x, z)) return true;
+        return (row(z)[x >> 6] >> (x & 63)) & 1;
+    }
+
+    void set(int x, int z, bool wall) {
+        uint64_t& w = row(z)[x >> 6];
+        uint64_t bit = 1ULL << (x & 63);
+        if (wall) w |= bit; else w &= ~bit;
+    }
+
+    // Set every cell, keeping row padding bits clear
+    void fill(bool wall) {
+        for (int z = 0; z < height; z++) {
+            uint64_t* r = row(z);
+            for (int i = 0; i < wordsPerRow; i++) {
+                r[i] = wall ? validMask(i) : 0;
+            }
+        }
+    }
+
+    // ========================================================================
+    // BULK QUERIES
+    // ========================================================================
+
+    // True if any cell in row z, columns [x0, x1], is a wall.
+    // Columns are clamped to the grid; a span within one word is one AND.
+    bool anyWallInSpan(int z, int x0, int x1) const {
+        if (z < 0 || z >= height) return false;
+        if (x0 < 0) x0 = 0;
+        if (x1 >= width) x1 = width - 1;
+        if (x0 > x1) return false;
+
+        const uint64_t* r = row(z);
+        int w0 = x0 >> 6, w1 = x1 >> 6;
+        if (w0 == w1) {
+            return (r[w0] & bitSpanMask(x0 & 63, x1 & 63)) != 0;
+        }
+        if (r[w0] & bitSpanMask(x0 & 63, 63)) return true;
+        for (int i = w0 + 1; i < w1; i++) {
+            if (r[i]) return true;
+        }
+        return (r[w1] & bitSpanMask(0, x1 & 63)) != 0;
+    }
+
+    int countWalls() const {
+        int total = 0;
+        size_t n = wordCount();
+        for (size_t i = 0; i < n; i++) total += popCount64(words[i]);
+        return total;
+    }
+
+    int countOpen() const {
+        return width * height - countWalls();
+    }
+
+    int countOpenInRow(int z) const {
+        int walls = 0;
+        const uint64_t* r = row(z);
+        for (int i = 0; i < wordsPerRow; i++) walls += popCount64(r[i]);
+        return width - walls;
+    }
+
+    // Find the first open cell at or after (x, z) in row-major order.
+    // Returns false if there is none.
+    bool findNextOpen(int& x, int& z) const {
+        if (x < 0) x = 0;
+        for (; z < height; z++, x = 0) {
+            const uint64_t* r = row(z);
+            for (int i = x >> 6; i < wordsPerRow; i++) {
+                uint64_t open = ~r[i] & validMask(i);
+                if (i == (x >> 6)) open &= ~((1ULL << (x & 63)) - 1);
+                if (open) {
+                    x = (i << 6) + lowestBit64(open);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Find the n-th open cell (0-based) in row-major order.
+    // Skips whole words with popcount, so it touches one word per 64 cells.
+    bool selectOpen(int n, int& x, int& z) const {
+        for (int zz = 0; zz < height; zz++) {
+            const uint64_t* r = row(zz);
+            for (int i = 0; i < wordsPerRow; i++) {
+                uint64_t open = ~r[i] & validMask(i);
+                int c = popCount64(open);
+                if (n >= c) { n -= c; continue; }
+                while (n-- > 0) open &= open - 1;
+                x = (i << 6) + lowestBit64(open);
+                z = zz;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::vector<uint64_t> storage;
+    uint64_t* words;
+
+    // Bits of word i that map to real columns (padding excluded)
+    uint64_t validMask(int i) const {
+        int last = width - 1 - (i << 6);
+        if (last >= 63) return ~0ULL;
+        return bitSpanMask(0, last);
+    }
+
+    void copyFrom(const BitGrid& other) {
+        width = other.width;
+        height = other.height;
+        wordsPerRow = other.wordsPerRow;
+        if (other.isBorrowed()) {
+            storage.clear();
+            words = other.words;
+        } else {
+            storage = other.storage;
+            words = storage.empty() ? NULL : &storage[0];
+        }
+    }
+};
+
+#endif // BITGRID_H
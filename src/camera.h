@@ -13,8 +13,32 @@
 #define CAMERA_H
 
 #include "matrix.h"
+#include "fasttrig.h"
 #include <cmath>
 
+// ============================================================================
+// VIEW WEDGE - the view frustum projected onto the XZ plane
+// Conservative visibility test for vertical columns (wall cells):
+// a column is hidden only if its footprint circle lies fully outside.
+// ============================================================================
+struct ViewWedge {
+    float eyeX, eyeZ;
+    float leftNX, leftNZ;       // Inward normals of the two side planes
+    float rightNX, rightNZ;
+    float farDistance;
+    bool sidesEnabled;          // False when the view is steep enough to see all around
+
+    bool isColumnVisible(float x, float z, float radius) const {
+        float dx = x - eyeX;
+        float dz = z - eyeZ;
+        float reach = farDistance + radius;
+        if (dx * dx + dz * dz > reach * reach) return false;
+        if (!sidesEnabled) return true;
+        return dx * leftNX + dz * leftNZ >= -radius &&
+               dx * rightNX + dz * rightNZ >= -radius;
+    }
+};
+
 class Camera {
 public:
     // Camera position in World Coordinate System
@@ -79,9 +103,12 @@ public:
     // dz = -cos(φ) * cos(θ)
     // ========================================================================
     void updateLookAt() {
-        float dx = cos(phi) * sin(theta);
-        float dy = sin(phi);
-        float dz = -cos(phi) * cos(theta);
+        float sinTheta, cosTheta, sinPhi, cosPhi;
+        fastSinCos(theta, sinTheta, cosTheta);
+        fastSinCos(phi, sinPhi, cosPhi);
+        float dx = cosPhi * sinTheta;
+        float dy = sinPhi;
+        float dz = -cosPhi * cosTheta;
         
         lookAt.x = position.x + dx;
         lookAt.y = position.y + dy;
@@ -89,21 +116,25 @@ public:
     }
     
     // Get forward direction vector
+    // (cos(phi) only scales the xz part, which is normalized anyway)
     Vec4 getForward() const {
+        float sinTheta, cosTheta;
+        fastSinCos(theta, sinTheta, cosTheta);
         Vec4 forward;
-        forward.x = cos(phi) * sin(theta);
+        forward.x = sinTheta;
         forward.y = 0; // For movement, ignore vertical
-        forward.z = -cos(phi) * cos(theta);
-        forward.normalize();
+        forward.z = -cosTheta;
         return forward;
     }
     
     // Get right direction vector
     Vec4 getRight() const {
+        float sinTheta, cosTheta;
+        fastSinCos(theta, sinTheta, cosTheta);
         Vec4 right;
-        right.x = cos(theta);
+        right.x = cosTheta;
         right.y = 0;
-        right.z = sin(theta);
+        right.z = sinTheta;
         return right;
     }
     
@@ -135,6 +166,37 @@ public:
         updateLookAt();
     }
     
+    // ========================================================================
+    // VIEW WEDGE
+    // The widest horizontal angle of a frustum ray pitched by phi is
+    // atan(tan(hfov/2) * cos(vfov/2) / cos(|phi| + vfov/2)).
+    // ========================================================================
+    ViewWedge getViewWedge(float fovY, float aspect, float farDist) const {
+        ViewWedge w;
+        w.eyeX = position.x;
+        w.eyeZ = position.z;
+        w.farDistance = farDist;
+        
+        float halfV = fovY * 0.5f * (float)M_PI / 180.0f;
+        float tanHalfH = tanf(halfV) * aspect;
+        float denom = cosf(fabsf(phi) + halfV);
+        w.sidesEnabled = denom > 1e-3f;
+        
+        float halfAngle = w.sidesEnabled ? atanf(tanHalfH * cosf(halfV) / denom) : 0.0f;
+        w.sidesEnabled = w.sidesEnabled && halfAngle < (float)M_PI / 2 - 1e-3f;
+        
+        float sinTheta, cosTheta, s, c;
+        fastSinCos(theta, sinTheta, cosTheta);
+        fastSinCos(halfAngle, s, c);
+        float fx = sinTheta, fz = -cosTheta;
+        float rx = cosTheta, rz = sinTheta;
+        w.leftNX = fx * s + rx * c;
+        w.leftNZ = fz * s + rz * c;
+        w.rightNX = fx * s - rx * c;
+        w.rightNZ = fz * s - rz * c;
+        return w;
+    }
+    
     // Set position with collision check
     void setPosition(float x, float y, float z) {
         position.x = x;
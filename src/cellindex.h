@@ -0,0 +1,155 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Empty Cell Index Header
+ *
+ * Indexed list of empty cells for spawning:
+ * - O(1) uniform sampling (no rejection loops)
+ * - Cells bucketed by ring (Chebyshev) distance from a source cell,
+ *   so "at least k cells from start" is a contiguous range -> O(1) sample
+ * - O(buckets) insert/remove for cells that change at runtime
+ ******************************************************************************/
+
+#ifndef CELLINDEX_H
+#define CELLINDEX_H
+
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+// Uniform index in [0, n); combines two rand() calls when RAND_MAX is small
+inline int randomIndex(int n) {
+    if (n <= RAND_MAX) return rand() % n;
+    unsigned int r = ((unsigned int)rand() << 15) ^ (unsigned int)rand();
+    return (int)(r % (unsigned int)n);
+}
+
+// ============================================================================
+// EMPTY CELL INDEX CLASS
+// cells[] is kept sorted by distance bucket; bucketStart[b] is the first
+// slot of bucket b and bucketStart[numBuckets] == cells.size().
+// ============================================================================
+class EmptyCellIndex {
+public:
+    EmptyCellIndex() : width(0), height(0), sourceX(0), sourceZ(0), numBuckets(0) {}
+
+    // Reset to an empty index over a width x height grid
+    void init(int w, int h, int srcX, int srcZ) {
+        width = w;
+        height = h;
+        sourceX = srcX;
+        sourceZ = srcZ;
+        numBuckets = std::max(std::max(srcX, w - 1 - srcX), std::max(srcZ, h - 1 - srcZ)) + 1;
+        cells.clear();
+        slot.assign((size_t)w * h, -1);
+        bucketStart.assign(numBuckets + 1, 0);
+    }
+
+    int size() const { return (int)cells.size(); }
+
+    int distance(int x, int z) const {
+        return std::max(std::abs(x - sourceX), std::abs(z - sourceZ));
+    }
+
+    bool contains(int x, int z) const {
+        return slot[id(x, z)] >= 0;
+    }
+
+    // Number of indexed cells whose distance lies in [minDist, maxDist]
+    int countInBand(int minDist, int maxDist) const {
+        int lo, hi;
+        bandRange(minDist, maxDist, lo, hi);
+        return hi - lo;
+    }
+
+    // ========================================================================
+    // UPDATES
+    // ========================================================================
+    void insert(int x, int z) {
+        int c = id(x, z);
+        if (slot[c] >= 0) return;
+        int b = distance(x, z);
+
+        // Open a hole at the end of bucket b by rotating the first cell of
+        // every later bucket to that bucket's end.
+        cells.push_back(-1);
+        int hole = (int)cells.size() - 1;
+        bucketStart[numBuckets]++;
+        for (int bk = numBuckets - 1; bk > b; bk--) {
+            int first = bucketStart[bk];
+            if (first != hole) place(cells[first], hole);
+            hole = first;
+            bucketStart[bk]++;
+        }
+        place(c, hole);
+    }
+
+    void remove(int x, int z) {
+        int c = id(x, z);
+        int p = slot[c];
+        if (p < 0) return;
+        int b = distance(x, z);
+
+        // Fill p with the last cell of bucket b, then shift the hole through
+        // later buckets by moving each bucket's last cell into it.
+        int hole = bucketStart[b + 1] - 1;
+        if (hole != p) place(cells[hole], p);
+        for (int bk = b + 1; bk < numBuckets; bk++) {
+            int last = bucketStart[bk + 1] - 1;
+            if (last != hole) place(cells[last], hole);
+            bucketStart[bk]--;
+            hole = last;
+        }
+        bucketStart[numBuckets]--;
+        cells.pop_back();
+        slot[c] = -1;
+    }
+
+    // ========================================================================
+    // SAMPLING
+    // ========================================================================
+
+    // Uniform over all indexed cells
+    bool sample(int& x, int& z) const {
+        return sampleInBand(0, numBuckets - 1, x, z);
+    }
+
+    // Uniform over cells at least minDist rings from the source
+    bool sampleAtLeast(int minDist, int& x, int& z) const {
+        return sampleInBand(minDist, numBuckets - 1, x, z);
+    }
+
+    // Uniform over cells whose distance lies in [minDist, maxDist]
+    bool sampleInBand(int minDist, int maxDist, int& x, int& z) const {
+        int lo, hi;
+        bandRange(minDist, maxDist, lo, hi);
+        if (hi <= lo) return false;
+        int c = cells[lo + randomIndex(hi - lo)];
+        x = c % width;
+        z = c / width;
+        return true;
+    }
+
+private:
+    int width, height;
+    int sourceX, sourceZ;
+    int numBuckets;
+    std::vector<int> cells;         // Cell ids, sorted by bucket
+    std::vector<int> slot;          // Cell id -> position in cells, or -1
+    std::vector<int> bucketStart;   // numBuckets + 1 offsets into cells
+
+    int id(int x, int z) const { return z * width + x; }
+
+    void place(int c, int pos) {
+        cells[pos] = c;
+        slot[c] = pos;
+    }
+
+    void bandRange(int minDist, int maxDist, int& lo, int& hi) const {
+        minDist = std::max(minDist, 0);
+        maxDist = std::min(maxDist, numBuckets - 1);
+        if (minDist > maxDist) { lo = hi = 0; return; }
+        lo = bucketStart[minDist];
+        hi = bucketStart[maxDist + 1];
+    }
+};
+
+#endif // CELLINDEX_H
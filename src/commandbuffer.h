@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Command Buffer Header
+ *
+ * Records draws now, replays them into a RenderBackend later:
+ * - A CommandBuffer is itself a RenderBackend, so scene code that submits
+ *   to a backend (walls, monsters, the key) records into it unchanged
+ * - Commands are stored flat: mesh draws as RenderItems, unlit meshes and
+ *   line strips in their own arrays, all in the frame arena
+ * - Buffers touch no GL and no shared state (their FrameCounters are
+ *   their own), so each worker can record a chunk of the scene into its
+ *   own buffer; one thread then replays them in order to the real backend
+ ******************************************************************************/
+
+#ifndef COMMANDBUFFER_H
+#define COMMANDBUFFER_H
+
+#include "matrix.h"
+#include "lighting.h"
+#include "framestats.h"
+#include "instancing.h"
+#include "renderqueue.h"
+#include "renderbackend.h"
+#include "arena.h"
+
+class CommandBuffer : public RenderBackend {
+public:
+    // Counted while recording; added to frameCounters() on replay
+    FrameCounters counters;
+
+    CommandBuffer() : RenderBackend(NULL) {}
+
+    const char* name() const { return "record"; }
+
+    int commandCount() const { return draws.size() + unlit.size() + lines.size(); }
+
+    // Start recording a new frame
+    void clear() {
+        draws.clear();
+        unlit.clear();
+        lines.clear();
+        linePoints.clear();
+        counters.reset();
+    }
+
+    void submit(int material, int mesh, const Matrix4x4& transform,
+                float param0 = 0, float param1 = 0, int lod = 0) {
+        RenderItem item;
+        item.transform = transform;
+        item.params[0] = param0;
+        item.params[1] = param1;
+        item.material = (unsigned short)material;
+        item.mesh = (unsigned char)mesh;
+        item.lod = (unsigned char)lod;
+        draws.push_back(item);
+    }
+
+    // The mesh is referenced, not copied: it must outlive the replay
+    void submitUnlit(const LocalMesh& mesh, const Matrix4x4& transform, const Color& color) {
+        UnlitCommand c;
+        c.mesh = &mesh;
+        c.transform = transform;
+        c.color = color;
+        unlit.push_back(c);
+    }
+
+    void drawLines(const Vec4* points, int count, const Color& color, float width) {
+        LineCommand c;
+        c.first = linePoints.size();
+        c.count = count;
+        c.color = color;
+        c.width = width;
+        linePoints.reserve(linePoints.size() + count);
+        for (int i = 0; i < count; i++) linePoints.push_back(points[i]);
+        lines.push_back(c);
+    }
+
+    // Send every command to target, in recording order per kind
+    void replay(RenderBackend& target) const {
+        for (int i = 0; i < draws.size(); i++) {
+            const RenderItem& d = draws[i];
+            target.submit(d.material, d.mesh, d.transform, d.params[0], d.params[1], d.lod);
+        }
+        for (int i = 0; i < unlit.size(); i++) {
+            target.submitUnlit(*unlit[i].mesh, unlit[i].transform, unlit[i].color);
+        }
+        for (int i = 0; i < lines.size(); i++) {
+            const LineCommand& l = lines[i];
+            target.drawLines(&linePoints[l.first], l.count, l.color, l.width);
+        }
+
+        FrameCounters& frame = frameCounters();
+        frame.vertices += counters.vertices;
+        frame.lightingEvals += counters.lightingEvals;
+        frame.cellsDrawn += counters.cellsDrawn;
+        frame.cellsCulled += counters.cellsCulled;
+    }
+
+    // Recording only: frames and the HUD belong to the replay target
+    void beginFrame(const FrameSetup&) {}
+    void endFrame() {}
+    void beginHud() {}
+    void hudPoints(const PointBuffer&, const Color&) {}
+    void endHud() {}
+
+private:
+    struct UnlitCommand {
+        const LocalMesh* mesh;
+        Matrix4x4 transform;
+        Color color;
+    };
+
+    struct LineCommand {
+        int first, count;
+        Color color;
+        float width;
+    };
+
+    ArenaList<RenderItem> draws;
+    ArenaList<UnlitCommand> unlit;
+    ArenaList<LineCommand> lines;
+    ArenaList<Vec4> linePoints;
+};
+
+#endif // COMMANDBUFFER_H
@@ -35,6 +35,16 @@ namespace Config {
     const float CELL_SIZE = 2.0f;
     const float WALL_HEIGHT = 2.0f;
     
+    // Shifting walls: every SHIFT_INTERVAL seconds a block of
+    // SHIFT_REGION_ROOMS x SHIFT_REGION_ROOMS rooms is re-carved
+    const float SHIFT_INTERVAL = 8.0f;
+    const int SHIFT_REGION_ROOMS = 3;
+    const int SHIFT_ATTEMPTS = 8;
+    
+    // Torches: point lights spread over the open cells
+    const int TORCH_COUNT = 16;
+    const float TORCH_HEIGHT = 1.2f;
+    
     // ============================================================================
     // GAME SETTINGS
     // ============================================================================
@@ -49,6 +59,10 @@ namespace Config {
     const float FAR_PLANE = 100.0f;
     const float FOV = 60.0f;
     
+    // Background colour; GL_EXP fog fades to it
+    const float SKY_COLOR[3] = {0.05f, 0.05f, 0.1f};
+    const float FOG_DENSITY = 0.05f;
+    
     // ============================================================================
     // HUD SETTINGS
     // ============================================================================
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Disjoint Set Header
+ *
+ * Union-find over cell ids:
+ * - Union by rank + path halving -> O(α(n)) find/unite
+ * - Used to answer "are these two cells connected?" for the maze
+ ******************************************************************************/
+
+#ifndef DISJOINTSET_H
+#define DISJOINTSET_H
+
+#include <vector>
+#include <algorithm>
+
+class DisjointSet {
+public:
+    DisjointSet() : sets(0) {}
+
+    // n singleton sets
+    void reset(int n) {
+        parent.resize(n);
+        rank.assign(n, 0);
+        for (int i = 0; i < n; i++) parent[i] = i;
+        sets = n;
+    }
+
+    int size() const { return (int)parent.size(); }
+
+    // Number of disjoint sets (including singletons)
+    int setCount() const { return sets; }
+
+    int find(int a) {
+        while (parent[a] != a) {
+            parent[a] = parent[parent[a]];  // Path halving
+            a = parent[a];
+        }
+        return a;
+    }
+
+    // Merge the sets of a and b; returns false if they were already joined
+    bool unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) rank[a]++;
+        sets--;
+        return true;
+    }
+
+    bool connected(int a, int b) {
+        return find(a) == find(b);
+    }
+
+private:
+    std::vector<int> parent;
+    std::vector<unsigned char> rank;
+    int sets;
+};
+
+#endif // DISJOINTSET_H
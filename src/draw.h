@@ -18,9 +18,12 @@
 #include "config.h"
 #include "matrix.h"
 #include "lighting.h"
+#include "lightgrid.h"
+#include "fasttrig.h"
 
 #include <cmath>
 #include <cstdlib>
+#include <vector>
 
 // ============================================================================
 // PRIMITIVE DRAWING FUNCTIONS
@@ -36,16 +39,17 @@ inline Vec4 transform(const Matrix4x4& m, const Vec4& v) {
     return Vec4(x, y, z);
 }
 
-// Draw a unit cube with manual lighting and back-face culling
-inline void drawUnitCubeManual(const Matrix4x4& M, const Vec4& viewPos, const Light& light, const Material& material) {
+// Emit a unit cube with manual lighting and back-face culling.
+// Emits GL_QUADS vertices; call inside glBegin(GL_QUADS).
+inline void emitUnitCubeManual(const Matrix4x4& M, const Vec4& viewPos, const LightSet& lights, const Material& material) {
     // Vertices of a unit cube centered at origin
-    Vec4 v[8] = {
+    static const Vec4 v[8] = {
         Vec4(-0.5f, -0.5f, 0.5f), Vec4(0.5f, -0.5f, 0.5f), Vec4(0.5f, 0.5f, 0.5f), Vec4(-0.5f, 0.5f, 0.5f), // Front
         Vec4(-0.5f, -0.5f, -0.5f), Vec4(0.5f, -0.5f, -0.5f), Vec4(0.5f, 0.5f, -0.5f), Vec4(-0.5f, 0.5f, -0.5f) // Back
     };
     
     // Faces (indices)
-    int faces[6][4] = {
+    static const int faces[6][4] = {
         {0, 1, 2, 3}, // Front (+Z)
         {5, 4, 7, 6}, // Back (-Z)
         {3, 2, 6, 7}, // Top (+Y)
@@ -53,92 +57,157 @@ inline void drawUnitCubeManual(const Matrix4x4& M, const Vec4& viewPos, const Li
         {1, 5, 6, 2}, // Right (+X)
         {4, 0, 3, 7}  // Left (-X)
     };
+    static const Vec4 faceNormals[6] = {
+        Vec4(0, 0, 1, 0), Vec4(0, 0, -1, 0), Vec4(0, 1, 0, 0),
+        Vec4(0, -1, 0, 0), Vec4(1, 0, 0, 0), Vec4(-1, 0, 0, 0)
+    };
+    
+    // Model matrices are affine: no per-vertex divide. The normal matrix
+    // keeps face normals correct for non-uniformly scaled cubes.
+    Affine3x4 A(M);
+    Affine3x4 N = A.normalMatrix();
+    
+    // Transform the 8 corners once; faces share them
+    Vec4 world[8];
+    for (int i = 0; i < 8; i++) world[i] = A.transformPoint(v[i]);
+    Vec4 centre = A.transformPoint(Vec4(0, 0, 0));
 
-    glBegin(GL_QUADS);
     for (int i = 0; i < 6; i++) {
-        // Transform vertices to world space
-        Vec4 p0 = transform(M, v[faces[i][0]]);
-        Vec4 p1 = transform(M, v[faces[i][1]]);
-        Vec4 p2 = transform(M, v[faces[i][2]]);
-        Vec4 p3 = transform(M, v[faces[i][3]]);
+        const Vec4& p0 = world[faces[i][0]];
+        const Vec4& p1 = world[faces[i][1]];
+        const Vec4& p2 = world[faces[i][2]];
+        const Vec4& p3 = world[faces[i][3]];
         
         // Back-face culling
         if (!isFaceVisible(p0, p1, p2, viewPos)) continue;
         
         // Draw face
-        Vec4 p[4] = {p0, p1, p2, p3};
+        const Vec4* p[4] = {&p0, &p1, &p2, &p3};
+        countVertices(4);
         
-        // Transform normal (assuming uniform scale, M is fine for direction)
-        // For correct normal transform with non-uniform scale, we need inverse transpose.
-        // But here we assume uniform or simple scaling.
-        // Actually, let's recalculate normal from world vertices to be safe and "manual"
-        Vec4 normal = (p1 - p0).cross(p2 - p0);
+        Vec4 normal = N.transformVector(faceNormals[i]);
         normal.normalize();
 
         for (int j = 0; j < 4; j++) {
-            // Calculate lighting
-            Color c = calculateLighting(p[j], normal, viewPos, light, material);
+            // Calculate lighting (cell lookups stepped towards the cube centre)
+            Color c = calculateLighting(*p[j], normal, viewPos, lights, material,
+                                        lightSamplePoint(*p[j], centre));
             glColor3f(c.r, c.g, c.b);
-            glVertex3f(p[j].x, p[j].y, p[j].z);
+            glVertex3f(p[j]->x, p[j]->y, p[j]->z);
         }
     }
+}
+
+// Draw a unit cube with manual lighting and back-face culling
+inline void drawUnitCubeManual(const Matrix4x4& M, const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    glBegin(GL_QUADS);
+    emitUnitCubeManual(M, viewPos, lights, material);
     glEnd();
 }
 
-// Draw a sphere manually with lighting
-inline void drawManualSphereManual(float radius, int slices, int stacks, const Matrix4x4& M, 
-                                 const Vec4& viewPos, const Light& light, const Material& material) {
-    const float PI = 3.14159265359f;
+// Emit a unit quad (xz plane, facing +y) with manual lighting.
+// Emits GL_QUADS vertices; call inside glBegin(GL_QUADS).
+inline void emitUnitQuadManual(const Matrix4x4& M, const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    static const Vec4 v[4] = {
+        Vec4(-0.5f, 0, -0.5f), Vec4(0.5f, 0, -0.5f), Vec4(0.5f, 0, 0.5f), Vec4(-0.5f, 0, 0.5f)
+    };
+    Affine3x4 A(M);
+    Vec4 normal = A.normalMatrix().transformVector(Vec4(0, 1, 0, 0));
+    normal.normalize();
+    Vec4 centre = A.transformPoint(Vec4(0, 0, 0));
+    countVertices(4);
+    
+    // Corners lie on cell borders: look up shadow and grid lights a little
+    // inside the quad
+    for (int i = 0; i < 4; i++) {
+        Vec4 p = A.transformPoint(v[i]);
+        Color c = calculateLighting(p, normal, viewPos, lights, material, lightSamplePoint(p, centre));
+        glColor3f(c.r, c.g, c.b);
+        glVertex3f(p.x, p.y, p.z);
+    }
+}
+
+// Emit a sphere manually with lighting, one quad per slice of each stack.
+// Emits GL_QUADS vertices; call inside glBegin(GL_QUADS).
+inline void emitSphereManual(float radius, int slices, int stacks, const Matrix4x4& M, 
+                             const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    countVertices(4 * slices * stacks);
+    
+    Affine3x4 A(M);
+    Affine3x4 N = A.normalMatrix();
+    
+    // Lit vertices of the previous column (lower and upper ring)
+    Vec4 prevW1, prevW2;
+    Color prevC1, prevC2;
     
     for (int i = 0; i < stacks; ++i) {
-        float phi1 = -PI/2 + (float)i / stacks * PI;
-        float phi2 = -PI/2 + (float)(i + 1) / stacks * PI;
+        // phi = a - pi/2 with a = i/stacks * pi: cos(phi) = sin(a), sin(phi) = -cos(a)
+        float cosPhi1, sinPhi1, cosPhi2, sinPhi2;
+        circleSinCos(i, 2 * stacks, cosPhi1, sinPhi1);
+        circleSinCos(i + 1, 2 * stacks, cosPhi2, sinPhi2);
+        sinPhi1 = -sinPhi1;
+        sinPhi2 = -sinPhi2;
         
-        glBegin(GL_QUAD_STRIP);
         for (int j = 0; j <= slices; ++j) {
-            float theta = (float)j / slices * 2 * PI;
+            float sinTheta, cosTheta;
+            circleSinCos(j, slices, sinTheta, cosTheta);
             
             // Vertices in local space
-            float x1 = radius * cos(phi1) * cos(theta);
-            float y1 = radius * sin(phi1);
-            float z1 = radius * cos(phi1) * sin(theta);
+            float x1 = radius * cosPhi1 * cosTheta;
+            float y1 = radius * sinPhi1;
+            float z1 = radius * cosPhi1 * sinTheta;
             
-            float x2 = radius * cos(phi2) * cos(theta);
-            float y2 = radius * sin(phi2);
-            float z2 = radius * cos(phi2) * sin(theta);
+            float x2 = radius * cosPhi2 * cosTheta;
+            float y2 = radius * sinPhi2;
+            float z2 = radius * cosPhi2 * sinTheta;
             
             Vec4 v1(x1, y1, z1);
             Vec4 v2(x2, y2, z2);
             
             // Transform to world space
-            Vec4 w1 = transform(M, v1);
-            Vec4 w2 = transform(M, v2);
+            Vec4 w1 = A.transformPoint(v1);
+            Vec4 w2 = A.transformPoint(v2);
             
             // Normals (local) - for sphere, normal is same as position (normalized)
-            Vec4 n1 = v1; n1.normalize(); n1.w = 0.0f; // Set w=0 for direction vector
-            Vec4 n2 = v2; n2.normalize(); n2.w = 0.0f;
+            Vec4 n1 = v1; n1.normalize();
+            Vec4 n2 = v2; n2.normalize();
             
-            // Transform normals (using M for rotation)
-            // Since w=0, translation in M will be ignored by transform()
-            Vec4 wn1 = transform(M, n1); wn1.normalize();
-            Vec4 wn2 = transform(M, n2); wn2.normalize();
+            // Transform normals with the normal matrix (no translation)
+            Vec4 wn1 = N.transformVector(n1); wn1.normalize();
+            Vec4 wn2 = N.transformVector(n2); wn2.normalize();
             
             // Lighting
-            Color c1 = calculateLighting(w1, wn1, viewPos, light, material);
-            glColor3f(c1.r, c1.g, c1.b);
-            glVertex3f(w1.x, w1.y, w1.z);
+            Color c1 = calculateLighting(w1, wn1, viewPos, lights, material);
+            Color c2 = calculateLighting(w2, wn2, viewPos, lights, material);
             
-            Color c2 = calculateLighting(w2, wn2, viewPos, light, material);
-            glColor3f(c2.r, c2.g, c2.b);
-            glVertex3f(w2.x, w2.y, w2.z);
+            // Quad between the previous column and this one
+            if (j > 0) {
+                glColor3f(prevC1.r, prevC1.g, prevC1.b);
+                glVertex3f(prevW1.x, prevW1.y, prevW1.z);
+                glColor3f(prevC2.r, prevC2.g, prevC2.b);
+                glVertex3f(prevW2.x, prevW2.y, prevW2.z);
+                glColor3f(c2.r, c2.g, c2.b);
+                glVertex3f(w2.x, w2.y, w2.z);
+                glColor3f(c1.r, c1.g, c1.b);
+                glVertex3f(w1.x, w1.y, w1.z);
+            }
+            prevW1 = w1; prevW2 = w2;
+            prevC1 = c1; prevC2 = c2;
         }
-        glEnd();
     }
 }
 
+// Draw a sphere manually with lighting
+inline void drawManualSphereManual(float radius, int slices, int stacks, const Matrix4x4& M, 
+                                 const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    glBegin(GL_QUADS);
+    emitSphereManual(radius, slices, stacks, M, viewPos, lights, material);
+    glEnd();
+}
+
 // Draw a cube with transformation using manual matrix multiplication 
 inline void drawCube(float x, float y, float z, float scaleX, float scaleY, float scaleZ, 
-                     const Vec4& viewPos, const Light& light, const Material& material, float rotY = 0) {
+                     const Vec4& viewPos, const LightSet& lights, const Material& material, float rotY = 0) {
     // Manual Matrix Construction
     // M = T * R * S
     
@@ -154,27 +223,55 @@ inline void drawCube(float x, float y, float z, float scaleX, float scaleY, floa
     // Combine: T * R * S
     Matrix4x4 M = T * R * S;
     
-    drawUnitCubeManual(M, viewPos, light, material);
+    drawUnitCubeManual(M, viewPos, lights, material);
 }
 
 // Draw a sphere with transformation using manual matrix multiplication (CG.4)
 inline void drawSphere(float x, float y, float z, float radius,
-                       const Vec4& viewPos, const Light& light, const Material& material) {
+                       const Vec4& viewPos, const LightSet& lights, const Material& material) {
     // Manual Translation Matrix
     Matrix4x4 T = createTranslationMatrix(x, y, z);
     
-    drawManualSphereManual(radius, 20, 20, T, viewPos, light, material);
+    drawManualSphereManual(radius, 20, 20, T, viewPos, lights, material);
 }
 
 // ============================================================================
 // CG.3 - 2D GRAPHICS ALGORITHMS
 // ============================================================================
 
-// Bresenham Line Algorithm (CG.3 1.1)
-// Draws a line from (x1, y1) to (x2, y2) in 2D space (Z=0)
-inline void drawLineBresenham(int x1, int y1, int x2, int y2) {
-    glBegin(GL_POINTS);
+// Reusable list of 2D integer points, submitted with a single draw call.
+// The rasterizers below append pixels here instead of issuing one
+// glVertex2i per pixel.
+class PointBuffer {
+public:
+    void clear() { coords.clear(); }
+    bool empty() const { return coords.empty(); }
+    int size() const { return (int)coords.size() / 2; }
     
+    void add(int x, int y) {
+        coords.push_back(x);
+        coords.push_back(y);
+    }
+    
+    int x(int i) const { return coords[2 * i]; }
+    int y(int i) const { return coords[2 * i + 1]; }
+    
+    void draw() const {
+        if (coords.empty()) return;
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(2, GL_INT, 0, &coords[0]);
+        glDrawArrays(GL_POINTS, 0, size());
+        glDisableClientState(GL_VERTEX_ARRAY);
+        countVertices(size());
+    }
+    
+private:
+    std::vector<GLint> coords;
+};
+
+// Bresenham Line Algorithm (CG.3 1.1)
+// Rasterizes a line from (x1, y1) to (x2, y2) in 2D space (Z=0)
+inline void rasterLineBresenham(int x1, int y1, int x2, int y2, PointBuffer& out) {
     int dx = abs(x2 - x1);
     int dy = abs(y2 - y1);
     int sx = (x1 < x2) ? 1 : -1;
@@ -182,7 +279,7 @@ inline void drawLineBresenham(int x1, int y1, int x2, int y2) {
     int err = dx - dy;
     
     while (true) {
-        glVertex2i(x1, y1);
+        out.add(x1, y1);
         
         if (x1 == x2 && y1 == y2) break;
         
@@ -196,28 +293,24 @@ inline void drawLineBresenham(int x1, int y1, int x2, int y2) {
             y1 += sy;
         }
     }
-    
-    glEnd();
 }
 
 // Midpoint Circle Algorithm (CG.3 1.2)
-// Draws a circle centered at (xc, yc) with radius r
-inline void drawCircleMidpoint(int xc, int yc, int r) {
-    glBegin(GL_POINTS);
-    
+// Rasterizes a circle centered at (xc, yc) with radius r
+inline void rasterCircleMidpoint(int xc, int yc, int r, PointBuffer& out) {
     int x = 0;
     int y = r;
     int p = 1 - r; // Initial decision parameter
     
     // Plot initial points
-    glVertex2i(xc + x, yc + y);
-    glVertex2i(xc - x, yc + y);
-    glVertex2i(xc + x, yc - y);
-    glVertex2i(xc - x, yc - y);
-    glVertex2i(xc + y, yc + x);
-    glVertex2i(xc - y, yc + x);
-    glVertex2i(xc + y, yc - x);
-    glVertex2i(xc - y, yc - x);
+    out.add(xc + x, yc + y);
+    out.add(xc - x, yc + y);
+    out.add(xc + x, yc - y);
+    out.add(xc - x, yc - y);
+    out.add(xc + y, yc + x);
+    out.add(xc - y, yc + x);
+    out.add(xc + y, yc - x);
+    out.add(xc - y, yc - x);
     
     while (x < y) {
         x++;
@@ -229,187 +322,149 @@ inline void drawCircleMidpoint(int xc, int yc, int r) {
         }
         
         // Plot points in all 8 octants
-        glVertex2i(xc + x, yc + y);
-        glVertex2i(xc - x, yc + y);
-        glVertex2i(xc + x, yc - y);
-        glVertex2i(xc - x, yc - y);
-        glVertex2i(xc + y, yc + x);
-        glVertex2i(xc - y, yc + x);
-        glVertex2i(xc + y, yc - x);
-        glVertex2i(xc - y, yc - x);
+        out.add(xc + x, yc + y);
+        out.add(xc - x, yc + y);
+        out.add(xc + x, yc - y);
+        out.add(xc - x, yc - y);
+        out.add(xc + y, yc + x);
+        out.add(xc - y, yc + x);
+        out.add(xc + y, yc - x);
+        out.add(xc - y, yc - x);
+    }
+}
+
+// Immediate helpers for one-off shapes; cache a PointBuffer for anything
+// drawn every frame
+inline void drawLineBresenham(int x1, int y1, int x2, int y2) {
+    static PointBuffer points;
+    points.clear();
+    rasterLineBresenham(x1, y1, x2, y2, points);
+    points.draw();
+}
+
+inline void drawCircleMidpoint(int xc, int yc, int r) {
+    static PointBuffer points;
+    points.clear();
+    rasterCircleMidpoint(xc, yc, r, points);
+    points.draw();
+}
+
+// HUD text in window coordinates (2D projection must be active)
+inline void drawText(int x, int y, const char* text) {
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; c++) {
+        glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
     }
-    
-    glEnd();
 }
 
 // ============================================================================
 // CG.5 - CURVES AND SURFACES
 // ============================================================================
 
-// Draw Cylinder (Ruled Surface) (CG.5 2.1)
-// Parametric equation: x = r*cos(u), z = r*sin(u), y = v
-inline void drawManualCylinder(float radius, float height, int slices) {
-    const float PI = 3.14159265359f;
-    float halfHeight = height / 2.0f;
-    
-    glBegin(GL_QUAD_STRIP);
-    for (int i = 0; i <= slices; i++) {
-        float theta = (float)i / slices * 2.0f * PI;
-        float x = radius * cos(theta);
-        float z = radius * sin(theta);
-        
-        glNormal3f(x/radius, 0, z/radius);
-        glVertex3f(x, -halfHeight, z);
-        glVertex3f(x, halfHeight, z);
-    }
-    glEnd();
-    
-    // Caps
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, 1, 0);
-    glVertex3f(0, halfHeight, 0);
-    for (int i = 0; i <= slices; i++) {
-        float theta = (float)i / slices * 2.0f * PI;
-        glVertex3f(radius * cos(theta), halfHeight, radius * sin(theta));
-    }
-    glEnd();
+// Emit a cone manually with lighting: side and base fans as triangles.
+// Emits GL_TRIANGLES vertices; call inside glBegin(GL_TRIANGLES).
+inline void emitConeManual(float radius, float height, int slices, const Matrix4x4& M,
+                           const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    countVertices(6 * slices);
     
-    glBegin(GL_TRIANGLE_FAN);
-    glNormal3f(0, -1, 0);
-    glVertex3f(0, -halfHeight, 0);
-    for (int i = 0; i <= slices; i++) {
-        float theta = -(float)i / slices * 2.0f * PI;
-        glVertex3f(radius * cos(theta), -halfHeight, radius * sin(theta));
-    }
-    glEnd();
-}
-
-// Draw Cone manually with lighting
-inline void drawManualConeManual(float radius, float height, int slices, const Matrix4x4& M,
-                               const Vec4& viewPos, const Light& light, const Material& material) {
-    const float PI = 3.14159265359f;
+    Affine3x4 A(M);
+    Affine3x4 N = A.normalMatrix();
     
     // Cone Side
-    glBegin(GL_TRIANGLE_FAN);
     
     // Tip
     Vec4 tipLocal(0, height, 0);
-    Vec4 tipWorld = transform(M, tipLocal);
-    Vec4 tipNormalLocal(0, 1, 0); tipNormalLocal.w = 0;
-    Vec4 tipNormalWorld = transform(M, tipNormalLocal); tipNormalWorld.normalize();
+    Vec4 tipWorld = A.transformPoint(tipLocal);
+    Vec4 tipNormalWorld = N.transformVector(Vec4(0, 1, 0)); tipNormalWorld.normalize();
     
-    Color cTip = calculateLighting(tipWorld, tipNormalWorld, viewPos, light, material);
-    glColor3f(cTip.r, cTip.g, cTip.b);
-    glVertex3f(tipWorld.x, tipWorld.y, tipWorld.z);
+    Color cTip = calculateLighting(tipWorld, tipNormalWorld, viewPos, lights, material);
     
+    Vec4 prevWorld;
+    Color prevColor;
     for (int i = 0; i <= slices; i++) {
-        float theta = (float)i / slices * 2.0f * PI;
-        float x = radius * cos(theta);
-        float z = radius * sin(theta);
+        float sinTheta, cosTheta;
+        circleSinCos(i, slices, sinTheta, cosTheta);
+        float x = radius * cosTheta;
+        float z = radius * sinTheta;
         
         Vec4 vLocal(x, 0, z);
-        Vec4 vWorld = transform(M, vLocal);
+        Vec4 vWorld = A.transformPoint(vLocal);
         
         // Normal calculation
         float ny = radius / height;
-        Vec4 nLocal(x/radius, ny, z/radius); nLocal.w = 0;
-        Vec4 nWorld = transform(M, nLocal); nWorld.normalize();
+        Vec4 nLocal(x/radius, ny, z/radius);
+        Vec4 nWorld = N.transformVector(nLocal); nWorld.normalize();
         
-        Color c = calculateLighting(vWorld, nWorld, viewPos, light, material);
-        glColor3f(c.r, c.g, c.b);
-        glVertex3f(vWorld.x, vWorld.y, vWorld.z);
+        Color c = calculateLighting(vWorld, nWorld, viewPos, lights, material);
+        if (i > 0) {
+            glColor3f(cTip.r, cTip.g, cTip.b);
+            glVertex3f(tipWorld.x, tipWorld.y, tipWorld.z);
+            glColor3f(prevColor.r, prevColor.g, prevColor.b);
+            glVertex3f(prevWorld.x, prevWorld.y, prevWorld.z);
+            glColor3f(c.r, c.g, c.b);
+            glVertex3f(vWorld.x, vWorld.y, vWorld.z);
+        }
+        prevWorld = vWorld;
+        prevColor = c;
     }
-    glEnd();
     
     // Base
-    glBegin(GL_TRIANGLE_FAN);
     
     // Center of base
     Vec4 baseCenterLocal(0, 0, 0);
-    Vec4 baseCenterWorld = transform(M, baseCenterLocal);
-    Vec4 baseNormalLocal(0, -1, 0); baseNormalLocal.w = 0;
-    Vec4 baseNormalWorld = transform(M, baseNormalLocal); baseNormalWorld.normalize();
+    Vec4 baseCenterWorld = A.transformPoint(baseCenterLocal);
+    Vec4 baseNormalWorld = N.transformVector(Vec4(0, -1, 0)); baseNormalWorld.normalize();
     
-    Color cBase = calculateLighting(baseCenterWorld, baseNormalWorld, viewPos, light, material);
-    glColor3f(cBase.r, cBase.g, cBase.b);
-    glVertex3f(baseCenterWorld.x, baseCenterWorld.y, baseCenterWorld.z);
+    Color cBase = calculateLighting(baseCenterWorld, baseNormalWorld, viewPos, lights, material);
     
     for (int i = 0; i <= slices; i++) {
-        float theta = -(float)i / slices * 2.0f * PI;
-        float x = radius * cos(theta);
-        float z = radius * sin(theta);
+        float sinTheta, cosTheta;
+        circleSinCos(-i, slices, sinTheta, cosTheta);
+        float x = radius * cosTheta;
+        float z = radius * sinTheta;
         
         Vec4 vLocal(x, 0, z);
-        Vec4 vWorld = transform(M, vLocal);
+        Vec4 vWorld = A.transformPoint(vLocal);
         
         // Normal is same as center for flat base
-        Color c = calculateLighting(vWorld, baseNormalWorld, viewPos, light, material);
-        glColor3f(c.r, c.g, c.b);
-        glVertex3f(vWorld.x, vWorld.y, vWorld.z);
+        Color c = calculateLighting(vWorld, baseNormalWorld, viewPos, lights, material);
+        if (i > 0) {
+            glColor3f(cBase.r, cBase.g, cBase.b);
+            glVertex3f(baseCenterWorld.x, baseCenterWorld.y, baseCenterWorld.z);
+            glColor3f(prevColor.r, prevColor.g, prevColor.b);
+            glVertex3f(prevWorld.x, prevWorld.y, prevWorld.z);
+            glColor3f(c.r, c.g, c.b);
+            glVertex3f(vWorld.x, vWorld.y, vWorld.z);
+        }
+        prevWorld = vWorld;
+        prevColor = c;
     }
-    glEnd();
 }
 
-// Draw Torus (Surface of Revolution) (CG.5 2.2)
-// x = (R + r*cos(v)) * cos(u)
-// y = (R + r*cos(v)) * sin(u)
-// z = r * sin(v)
-// Note: In our system Y is up, so we swap y and z usually, or rotate.
-// Let's implement standard torus lying on XZ plane.
-inline void drawManualTorus(float innerRadius, float outerRadius, int nsides, int rings) {
-    const float PI = 3.14159265359f;
-    float ringRadius = (outerRadius - innerRadius) / 2.0f;
-    float centerRadius = innerRadius + ringRadius;
-    
-    for (int i = 0; i < rings; i++) {
-        float theta = (float)i / rings * 2.0f * PI;
-        float nextTheta = (float)(i + 1) / rings * 2.0f * PI;
-        
-        glBegin(GL_QUAD_STRIP);
-        for (int j = 0; j <= nsides; j++) {
-            float phi = (float)j / nsides * 2.0f * PI;
-            
-            float cosPhi = cos(phi);
-            float sinPhi = sin(phi);
-            float cosTheta = cos(theta);
-            float sinTheta = sin(theta);
-            float cosNextTheta = cos(nextTheta);
-            float sinNextTheta = sin(nextTheta);
-            
-            // Current ring
-            float x = (centerRadius + ringRadius * cosPhi) * cosTheta;
-            float z = (centerRadius + ringRadius * cosPhi) * sinTheta;
-            float y = ringRadius * sinPhi;
-            
-            // Normal
-            glNormal3f(cosPhi * cosTheta, sinPhi, cosPhi * sinTheta);
-            glVertex3f(x, y, z);
-            
-            // Next ring
-            float nx = (centerRadius + ringRadius * cosPhi) * cosNextTheta;
-            float nz = (centerRadius + ringRadius * cosPhi) * sinNextTheta;
-            float ny = ringRadius * sinPhi;
-            
-            glNormal3f(cosPhi * cosNextTheta, sinPhi, cosPhi * sinNextTheta);
-            glVertex3f(nx, ny, nz);
-        }
-        glEnd();
-    }
+// Draw Cone manually with lighting
+inline void drawManualConeManual(float radius, float height, int slices, const Matrix4x4& M,
+                               const Vec4& viewPos, const LightSet& lights, const Material& material) {
+    glBegin(GL_TRIANGLES);
+    emitConeManual(radius, height, slices, M, viewPos, lights, material);
+    glEnd();
 }
 
 // Bezier Curve (CG.5 1.1)
 // P(t) = (1-t)^3*P0 + 3(1-t)^2*t*P1 + 3(1-t)*t^2*P2 + t^3*P3
+inline Vec4 bezierPoint(const Vec4& p0, const Vec4& p1, const Vec4& p2, const Vec4& p3, float t) {
+    float u = 1.0f - t;
+    float tt = t * t;
+    float uu = u * u;
+    float uuu = uu * u;
+    float ttt = tt * t;
+    return p0 * uuu + p1 * (3 * uu * t) + p2 * (3 * u * tt) + p3 * ttt;
+}
+
 inline void drawBezierCurve(Vec4 p0, Vec4 p1, Vec4 p2, Vec4 p3, int segments) {
+    countVertices(segments + 1);
     glBegin(GL_LINE_STRIP);
     for (int i = 0; i <= segments; i++) {
-        float t = (float)i / segments;
-        float u = 1.0f - t;
-        float tt = t * t;
-        float uu = u * u;
-        float uuu = uu * u;
-        float ttt = tt * t;
-        
-        Vec4 p = p0 * uuu + p1 * (3 * uu * t) + p2 * (3 * u * tt) + p3 * ttt;
+        Vec4 p = bezierPoint(p0, p1, p2, p3, (float)i / segments);
         glVertex3f(p.x, p.y, p.z);
     }
     glEnd();
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Fast Trigonometry Header
+ *
+ * sin/cos without libm calls for tessellation, the camera and monster AI:
+ * - fastSinCos(x, s, c): one range reduction by pi/2 (three-part pi/2, so
+ *   large camera angles stay accurate), then minimax polynomials on
+ *   [-pi/4, pi/4] for both results. Against double-precision libm the
+ *   absolute error stays below 1e-7 for |x| <= 1e4 (ShiftingMazeBench
+ *   measures it)
+ * - circleSinCos(i, steps, s, c): sin/cos of i/steps of a full turn, read
+ *   from tables built once from libm for every step count up to
+ *   CIRCLE_TABLE_MAX_STEPS (error below 3e-8); larger step counts fall
+ *   back to fastSinCos. Tessellators use fixed step counts per LOD.
+ * Results are plain float arithmetic, so replays stay deterministic.
+ ******************************************************************************/
+
+#ifndef FASTTRIG_H
+#define FASTTRIG_H
+
+#include <cmath>
+
+const float TRIG_PI = 3.14159265358979f;
+const float TRIG_TWO_OVER_PI = 0.636619772367581f;
+
+// pi/2 in three parts; the first two have few mantissa bits, so j * part
+// is exact for the j a float angle can produce
+const float TRIG_PIO2_1 = 1.5703125f;
+const float TRIG_PIO2_2 = 4.837512969970703125e-4f;
+const float TRIG_PIO2_3 = 7.54978995489188216e-8f;
+
+// ============================================================================
+// POLYNOMIAL SIN/COS
+// ============================================================================
+
+// Both valid for |r| <= pi/4
+inline float sinPoly(float r) {
+    float r2 = r * r;
+    return r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+}
+
+inline float cosPoly(float r) {
+    float r2 = r * r;
+    return 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f +
+           r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+}
+
+inline void fastSinCos(float x, float& s, float& c) {
+    // Nearest multiple of pi/2 (adding 1.5 * 2^23 rounds to an integer)
+    // and the remainder in [-pi/4, pi/4]
+    float fj = (x * TRIG_TWO_OVER_PI + 12582912.0f) - 12582912.0f;
+    int j = (int)fj;
+    float r = ((x - fj * TRIG_PIO2_1) - fj * TRIG_PIO2_2) - fj * TRIG_PIO2_3;
+
+    // Quadrant without branches (random angles would mispredict them):
+    // odd quadrants swap sin and cos, then signs follow the quadrant
+    float sr = sinPoly(r);
+    float cr = cosPoly(r);
+    float s0 = (j & 1) ? cr : sr;
+    float c0 = (j & 1) ? sr : cr;
+    s = (j & 2) ? -s0 : s0;
+    c = ((j + 1) & 2) ? -c0 : c0;
+}
+
+inline float fastSin(float x) {
+    float s, c;
+    fastSinCos(x, s, c);
+    return s;
+}
+
+inline float fastCos(float x) {
+    float s, c;
+    fastSinCos(x, s, c);
+    return c;
+}
+
+// ============================================================================
+// CIRCLE TABLES
+// Table n holds angles i * 2*pi / n for i in [0, n], packed one after the
+// other in a fixed array (no heap).
+// ============================================================================
+const int CIRCLE_TABLE_MAX_STEPS = 64;
+const int CIRCLE_TABLE_ENTRIES = CIRCLE_TABLE_MAX_STEPS * (CIRCLE_TABLE_MAX_STEPS + 3) / 2;
+
+class CircleTables {
+public:
+    CircleTables() {
+        int next = 0;
+        for (int steps = 1; steps <= CIRCLE_TABLE_MAX_STEPS; steps++) {
+            first[steps] = next;
+            for (int i = 0; i <= steps; i++) {
+                double angle = 2.0 * 3.14159265358979323846 * i / steps;
+                sines[next] = (float)sin(angle);
+                cosines[next] = (float)cos(angle);
+                next++;
+            }
+        }
+    }
+
+    // Caller checks 1 <= steps <= CIRCLE_TABLE_MAX_STEPS and 0 <= i <= steps
+    void lookup(int i, int steps, float& s, float& c) const {
+        int k = first[steps] + i;
+        s = sines[k];
+        c = cosines[k];
+    }
+
+private:
+    int first[CIRCLE_TABLE_MAX_STEPS + 1];
+    float sines[CIRCLE_TABLE_ENTRIES];
+    float cosines[CIRCLE_TABLE_ENTRIES];
+};
+
+inline const CircleTables& circleTables() {
+    static CircleTables tables;
+    return tables;
+}
+
+// sin and cos of i/steps of a full turn (steps >= 1); i may be negative or
+// past steps
+inline void circleSinCos(int i, int steps, float& s, float& c) {
+    if (steps > CIRCLE_TABLE_MAX_STEPS) {
+        fastSinCos((float)i / steps * 2.0f * TRIG_PI, s, c);
+        return;
+    }
+    if (i < 0 || i > steps) {
+        i %= steps;
+        if (i < 0) i += steps;
+    }
+    circleTables().lookup(i, steps, s, c);
+}
+
+#endif // FASTTRIG_H
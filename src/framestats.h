@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Frame Statistics Header
+ *
+ * Rolling per-frame performance counters:
+ * - Frame interval, sim tick time, vertices submitted, lighting evaluations
+ *   drawn/culled maze cells, frame arena use and heap allocations for the
+ *   last STATS_HISTORY frames
+ * - Fixed-size ring buffers and scratch arrays: nothing on the hot path
+ *   allocates
+ * - Percentiles, histogram and CSV export for the HUD overlay
+ ******************************************************************************/
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// ============================================================================
+// RING BUFFER
+// Keeps the newest N items; index 0 is the oldest one still held.
+// ============================================================================
+template <typename T, int N>
+class RingBuffer {
+public:
+    RingBuffer() : head(0), count(0) {}
+
+    void push(const T& item) {
+        items[head] = item;
+        head = (head + 1) % N;
+        if (count < N) count++;
+    }
+
+    int size() const { return count; }
+    static int capacity() { return N; }
+    bool empty() const { return count == 0; }
+
+    const T& operator[](int i) const {
+        return items[(head - count + i + N) % N];
+    }
+
+    const T& latest() const { return items[(head + N - 1) % N]; }
+
+    void clear() { head = count = 0; }
+
+private:
+    T items[N];
+    int head;
+    int count;
+};
+
+// ============================================================================
+// PER-FRAME COUNTERS
+// Bumped by the draw and lighting code while a frame is built.
+// ============================================================================
+struct FrameCounters {
+    unsigned int vertices;
+    unsigned int lightingEvals;
+    unsigned int cellsDrawn;
+    unsigned int cellsCulled;
+    unsigned int arenaBytes;        // Frame arena bytes handed out
+    unsigned int arenaOverflows;    // Frame arena trips to the heap
+    unsigned int heapAllocations;   // operator new calls while rendering
+    unsigned int heapBytes;
+    unsigned int simAllocations;    // operator new calls in sim ticks
+
+    FrameCounters() { reset(); }
+
+    void reset() {
+        vertices = lightingEvals = cellsDrawn = cellsCulled = 0;
+        arenaBytes = arenaOverflows = 0;
+        heapAllocations = heapBytes = simAllocations = 0;
+    }
+};
+
+// Counters of the frame currently being built. One set per thread: jobs
+// on the worker pool count into their own and the caller adds them up
+// (CommandBuffer, RenderQueue::flushSoftware).
+inline FrameCounters& frameCounters() {
+    static thread_local FrameCounters counters;
+    return counters;
+}
+
+inline void countVertices(unsigned int n) {
+    frameCounters().vertices += n;
+}
+
+// ============================================================================
+// FRAME STATISTICS
+// ============================================================================
+const int STATS_HISTORY = 600;          // 10 seconds at 60 FPS
+const int STATS_HISTOGRAM_BINS = 20;
+const float STATS_HISTOGRAM_MS = 2.0f;  // Bin width; the last bin holds the overflow
+
+struct FrameSample {
+    float frameMs;          // Interval since the previous frame started
+    float simMs;            // Time of the last sim tick
+    FrameCounters counters;
+};
+
+class FrameStats {
+public:
+    // Summary of the frames in the ring, refreshed by summarize()
+    float fps;
+    float averageMs;
+    float p50, p95, p99;
+    float maxMs;
+    int histogram[STATS_HISTOGRAM_BINS];
+    int histogramPeak;
+
+    FrameStats() : frameIndex(0), pendingMs(-1.0f), started(false) {
+        clearSummary();
+    }
+
+    // Start timing a frame and clear its counters
+    void beginFrame() {
+        Clock::time_point now = Clock::now();
+        pendingMs = started ? (float)std::chrono::duration<double, std::milli>(now - frameStart).count() : -1.0f;
+        frameStart = now;
+        started = true;
+        frameCounters().reset();
+    }
+
+    // Store the finished frame (the first frame has no interval and is skipped)
+    void endFrame(float simMs) {
+        if (pendingMs < 0) return;
+        FrameSample s;
+        s.frameMs = pendingMs;
+        s.simMs = simMs;
+        s.counters = frameCounters();
+        samples.push(s);
+        frameIndex++;
+    }
+
+    const RingBuffer<FrameSample, STATS_HISTORY>& history() const { return samples; }
+    bool empty() const { return samples.empty(); }
+    const FrameSample& latest() const { return samples.latest(); }
+
+    // Recompute percentiles and the histogram over the whole ring
+    void summarize() {
+        int n = samples.size();
+        clearSummary();
+        if (n == 0) return;
+
+        double total = 0;
+        for (int i = 0; i < n; i++) {
+            float ms = samples[i].frameMs;
+            scratch[i] = ms;
+            total += ms;
+            maxMs = std::max(maxMs, ms);
+
+            int bin = (int)(ms / STATS_HISTOGRAM_MS);
+            if (bin >= STATS_HISTOGRAM_BINS) bin = STATS_HISTOGRAM_BINS - 1;
+            histogram[bin]++;
+        }
+        for (int i = 0; i < STATS_HISTOGRAM_BINS; i++) {
+            histogramPeak = std::max(histogramPeak, histogram[i]);
+        }
+
+        averageMs = (float)(total / n);
+        fps = averageMs > 0 ? 1000.0f / averageMs : 0;
+        p50 = percentile(n, 0.50f);
+        p95 = percentile(n, 0.95f);
+        p99 = percentile(n, 0.99f);
+    }
+
+    // Write every frame still in the ring, oldest first
+    bool writeCsv(const char* path) const {
+        FILE* f = fopen(path, "w");
+        if (!f) {
+            printf("Cannot write frame stats to '%s'\n", path);
+            return false;
+        }
+        int n = samples.size();
+        unsigned int first = frameIndex - n;
+        fprintf(f, "frame,frame_ms,sim_ms,vertices,lighting_evals,cells_drawn,cells_culled,"
+                   "arena_bytes,arena_overflows,heap_allocs,heap_bytes,sim_allocs\n");
+        for (int i = 0; i < n; i++) {
+            const FrameSample& s = samples[i];
+            fprintf(f, "%u,%.3f,%.3f,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", first + i, s.frameMs, s.simMs,
+                    s.counters.vertices, s.counters.lightingEvals,
+                    s.counters.cellsDrawn, s.counters.cellsCulled,
+                    s.counters.arenaBytes, s.counters.arenaOverflows,
+                    s.counters.heapAllocations, s.counters.heapBytes, s.counters.simAllocations);
+        }
+        fclose(f);
+        printf("Wrote %d frame samples to %s\n", n, path);
+        return true;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    RingBuffer<FrameSample, STATS_HISTORY> samples;
+    float scratch[STATS_HISTORY];   // Partially sorted copy for percentiles
+    unsigned int frameIndex;        // Frames recorded since start
+    Clock::time_point frameStart;
+    float pendingMs;
+    bool started;
+
+    void clearSummary() {
+        fps = averageMs = p50 = p95 = p99 = maxMs = 0;
+        memset(histogram, 0, sizeof(histogram));
+        histogramPeak = 0;
+    }
+
+    // Nearest-rank percentile over scratch[0, n)
+    float percentile(int n, float p) {
+        int k = std::min(n - 1, (int)(p * n));
+        std::nth_element(scratch, scratch + k, scratch + n);
+        return scratch[k];
+    }
+};
+
+#endif // FRAMESTATS_H
@@ -10,14 +10,29 @@
 #include "config.h"
 #include "matrix.h"
 #include "camera.h"
+#include "fasttrig.h"
 #include "lighting.h"
 #include "maze.h"
 #include "input.h"
 #include "draw.h"
+#include "renderqueue.h"
+#include "renderbackend.h"
+#include "commandbuffer.h"
+#include "arena.h"
+#include "allocstats.h"
+#include "instancing.h"
+#include "transform.h"
+#include "replay.h"
+#include "framestats.h"
+#include "minimap.h"
+#include "shader.h"
+#include "lightgrid.h"
 
 #include <ctime>
 #include <cstdio>
+#include <chrono>
 #include <vector>
+#include <algorithm>
 
 // ============================================================================
 // GAME ENTITIES
@@ -29,13 +44,31 @@ struct Monster {
     float speed;
     float radius;
     
+    // Node 0 is the body, nodes 1..SPIKE_COUNT its spikes
+    TransformHierarchy parts;
+    Vec4 placedAt;                  // Position the body node was built for
+    LodSelector lod;
+    
     Monster(float x, float z) {
         position = Vec4(x, 0.5f, z);
         // Random direction
-        float angle = (float)(rand() % 360) * 3.14159f / 180.0f;
-        direction = Vec4(cos(angle), 0, sin(angle));
+        direction = randomDirection();
         speed = 2.0f;
         radius = 0.3f;
+        
+        placedAt = position;
+        int body = parts.addNode(-1, modelMatrix());
+        const Matrix4x4* spikes = spikeTransforms();
+        for (int i = 0; i < SPIKE_COUNT; i++) {
+            parts.addNode(body, spikes[i]);
+        }
+    }
+    
+    // Whole degrees, as one rand() call
+    static Vec4 randomDirection() {
+        float s, c;
+        fastSinCos((float)(rand() % 360) * 3.14159f / 180.0f, s, c);
+        return Vec4(c, 0, s);
     }
     
     void update(float dt, const Maze& maze) {
@@ -46,47 +79,58 @@ struct Monster {
             // Try to find a new valid direction
             // Reflect direction? Or just random new direction?
             // Let's try random new direction for simplicity
-            float angle = (float)(rand() % 360) * 3.14159f / 180.0f;
-            direction = Vec4(cos(angle), 0, sin(angle));
+            direction = randomDirection();
         } else {
             position = nextPos;
         }
     }
     
-    void draw(const Vec4& viewPos, const Light& light, const Material& material) {
-        // glColor3f(1.0f, 0.0f, 0.0f); // Red monster - handled by material now
-        
-        // Create red material for monster
-        Material monsterMat = material;
-        monsterMat.diffuse = Color(1.0f, 0.0f, 0.0f);
-        monsterMat.ambient = Color(0.3f, 0.0f, 0.0f);
-
-        Matrix4x4 T = createTranslationMatrix(position.x, position.y, position.z);
-        
-        // Draw body as sphere
-        drawManualSphereManual(radius, 15, 15, T, viewPos, light, monsterMat);
-        
-        // Draw spikes (Cones) - CG.5
-        // Yellow spikes material
-        Material spikeMat = material;
-        spikeMat.diffuse = Color(1.0f, 1.0f, 0.0f);
-        spikeMat.ambient = Color(0.3f, 0.3f, 0.0f);
-        
-        for(int i=0; i<8; i++) {
-            glPushMatrix();
-            
-            float angle = i * 45.0f * 3.14159f / 180.0f;
-            Matrix4x4 R = createRotationYMatrix(angle);
-            Matrix4x4 T2 = createTranslationMatrix(radius * 0.8f, 0, 0);
-            Matrix4x4 R2 = createRotationZMatrix(-90.0f * 3.14159f / 180.0f);
-            
-            Matrix4x4 M = T * R * T2 * R2; // Combine with monster position
-            // We don't need glMultMatrixf here because drawManualConeManual takes M directly
-            // But wait, M is Model matrix. drawManualConeManual expects Model matrix to transform to World.
-            // Yes, M is correct.
-            
-            drawManualConeManual(radius * 0.3f, radius * 0.6f, 10, M, viewPos, light, spikeMat);
-            glPopMatrix();
+    static const int SPIKE_COUNT = 8;
+    
+    // Spike placement on a unit-radius monster. Constant, so built once.
+    static const Matrix4x4* spikeTransforms() {
+        static Matrix4x4 spikes[SPIKE_COUNT];
+        static bool built = false;
+        if (!built) {
+            for (int i = 0; i < SPIKE_COUNT; i++) {
+                float angle = i * 45.0f * 3.14159f / 180.0f;
+                Matrix4x4 R = createRotationYMatrix(angle);
+                Matrix4x4 T2 = createTranslationMatrix(0.8f, 0, 0);
+                Matrix4x4 R2 = createRotationZMatrix(-90.0f * 3.14159f / 180.0f);
+                spikes[i] = R * T2 * R2;
+            }
+            built = true;
+        }
+        return spikes;
+    }
+    
+    // Unit monster -> world
+    Matrix4x4 modelMatrix() const {
+        return createTranslationMatrix(position.x, position.y, position.z) *
+               createScaleMatrix(radius, radius, radius);
+    }
+    
+    // Rebuild the body node only if the monster moved; spikes follow it
+    void syncTransforms() {
+        if (position.x != placedAt.x || position.y != placedAt.y || position.z != placedAt.z) {
+            parts.setLocal(0, modelMatrix());
+            placedAt = position;
+        }
+        parts.update();
+    }
+    
+    // Detail level from the on-screen size (spikes reach out to 1.4 radii)
+    int selectLod(const LodView& view) {
+        return lod.select(view.projectedSize(position, radius * 1.4f));
+    }
+    
+    // Submit the body sphere and eight spikes (cones) - CG.5
+    void draw(RenderBackend& backend, int bodyMaterial, int spikeMaterial, const LodView& view) {
+        syncTransforms();
+        int level = selectLod(view);
+        backend.submit(bodyMaterial, MESH_SPHERE, parts.world(0), 1.0f, 0, level);
+        for (int i = 1; i <= SPIKE_COUNT; i++) {
+            backend.submit(spikeMaterial, MESH_CONE, parts.world(i), 0.3f, 0.6f, level);
         }
     }
 };
@@ -97,10 +141,32 @@ struct Key {
     float radius;
     float rotation;
     
+    // Placement -> spin/tilt -> handle and teeth. The parts' local
+    // matrices never change; only the spin node is touched per frame.
+    enum { NODE_PLACE, NODE_SPIN, NODE_HANDLE, NODE_TOOTH1, NODE_TOOTH2 };
+    TransformHierarchy parts;
+    Vec4 placedAt;
+    float spunTo;
+    LodSelector lod;
+    
     Key() {
         collected = false;
         radius = 0.3f;
         rotation = 0.0f;
+        
+        placedAt = position;
+        spunTo = rotation;
+        parts.addNode(-1, placeMatrix());
+        parts.addNode(NODE_PLACE, spinMatrix());
+        
+        // Handle (Torus) stands upright above the shaft
+        Matrix4x4 T_handle = createTranslationMatrix(0, 0.3f, 0);
+        Matrix4x4 R_handle = createRotationXMatrix(90.0f * 3.14159f / 180.0f);
+        parts.addNode(NODE_SPIN, T_handle * R_handle);
+        
+        // Teeth (scaled cubes)
+        parts.addNode(NODE_SPIN, createTranslationMatrix(0, -0.2f, 0.1f) * createScaleMatrix(0.05f, 0.05f, 0.15f));
+        parts.addNode(NODE_SPIN, createTranslationMatrix(0, -0.1f, 0.1f) * createScaleMatrix(0.05f, 0.05f, 0.1f));
     }
     
     void update(float dt) {
@@ -108,55 +174,58 @@ struct Key {
         if (rotation > 360.0f) rotation -= 360.0f;
     }
     
-    void draw(const Vec4& viewPos, const Light& light, const Material& material) {
-        if (collected) return;
-        
-        // Gold material
-        Material goldMat = material;
-        goldMat.diffuse = Color(1.0f, 0.8f, 0.0f);
-        goldMat.ambient = Color(0.4f, 0.3f, 0.0f);
-        goldMat.specular = Color(1.0f, 1.0f, 0.5f);
-        goldMat.shininess = 50.0f;
-
-        // Calculate Model Matrix
-        Matrix4x4 T = createTranslationMatrix(position.x, position.y + 0.5f, position.z);
+    Matrix4x4 placeMatrix() const {
+        return createTranslationMatrix(position.x, position.y + 0.5f, position.z);
+    }
+    
+    Matrix4x4 spinMatrix() const {
         Matrix4x4 Ry = createRotationYMatrix(rotation * 3.14159f / 180.0f);
         Matrix4x4 Rx = createRotationXMatrix(45.0f * 3.14159f / 180.0f); // Tilt 45 degrees
-        Matrix4x4 M = T * Ry * Rx;
-
-        // 1. Draw Fixed-Function parts (Cylinder, Torus)
-        glPushMatrix();
-        glMultMatrixf(M.ptr()); // View * Model
-        
-        // Draw key shape using CG.5 primitives
-        glColor3f(1.0f, 0.8f, 0.0f); // Gold
-        
-        // Shaft (Cylinder)
-        glPushMatrix();
-        Matrix4x4 T_shaft = createTranslationMatrix(0, 0, 0);
-        glMultMatrixf(T_shaft.ptr());
-        drawManualCylinder(0.05f, 0.6f, 12);
-        glPopMatrix();
-        
-        // Handle (Torus)
-        glPushMatrix();
-        Matrix4x4 T_handle = createTranslationMatrix(0, 0.3f, 0);
-        Matrix4x4 R_handle = createRotationXMatrix(90.0f * 3.14159f / 180.0f);
-        Matrix4x4 M_handle = T_handle * R_handle;
-        glMultMatrixf(M_handle.ptr());
-        drawManualTorus(0.05f, 0.15f, 10, 20);
-        glPopMatrix();
-        
-        glPopMatrix(); // Restore View matrix
-
-        // 2. Draw Manual parts (Teeth)
-        // GL_MODELVIEW is now just View
+        return Ry * Rx;
+    }
+    
+    void syncTransforms() {
+        if (position.x != placedAt.x || position.y != placedAt.y || position.z != placedAt.z) {
+            parts.setLocal(NODE_PLACE, placeMatrix());
+            placedAt = position;
+        }
+        if (rotation != spunTo) {
+            parts.setLocal(NODE_SPIN, spinMatrix());
+            spunTo = rotation;
+        }
+        parts.update();
+    }
+    
+    // Unlit gold shaft and handle (CG.5 cylinder and torus); the lit
+    // teeth are submitted as cubes
+    void draw(RenderBackend& backend, int goldMaterial, const LodView& view) {
+        if (collected) return;
+        syncTransforms();
+        int level = lod.select(view.projectedSize(position + Vec4(0, 0.5f, 0), 0.35f));
         
-        Matrix4x4 M_tooth1 = M * createTranslationMatrix(0, -0.2f, 0.1f) * createScaleMatrix(0.05f, 0.05f, 0.15f);
-        drawUnitCubeManual(M_tooth1, viewPos, light, goldMat);
+        Color gold(1.0f, 0.8f, 0.0f);
+        backend.submitUnlit(shaftMesh(level), parts.world(NODE_SPIN), gold);
+        backend.submitUnlit(handleMesh(level), parts.world(NODE_HANDLE), gold);
         
-        Matrix4x4 M_tooth2 = M * createTranslationMatrix(0, -0.1f, 0.1f) * createScaleMatrix(0.05f, 0.05f, 0.1f);
-        drawUnitCubeManual(M_tooth2, viewPos, light, goldMat);
+        backend.pushCube(goldMaterial, parts.world(NODE_TOOTH1));
+        backend.pushCube(goldMaterial, parts.world(NODE_TOOTH2));
+    }
+    
+    // Shaft and handle meshes, built once per detail level
+    static const LocalMesh& shaftMesh(int level) {
+        static LocalMesh meshes[LOD_LEVELS];
+        if (meshes[level].vertexCount() == 0) {
+            buildCylinderMesh(meshes[level], 0.05f, 0.6f, CYLINDER_LOD_SLICES[level]);
+        }
+        return meshes[level];
+    }
+    
+    static const LocalMesh& handleMesh(int level) {
+        static LocalMesh meshes[LOD_LEVELS];
+        if (meshes[level].vertexCount() == 0) {
+            buildTorusMesh(meshes[level], 0.05f, 0.15f, TORUS_LOD_SIDES[level], TORUS_LOD_RINGS[level]);
+        }
+        return meshes[level];
     }
 };
 
@@ -168,6 +237,9 @@ public:
     // Core components
     Camera camera;
     Maze maze;
+    MazeGenerator* generator;       // Algorithm used for new mazes
+    MappedMazeFile mazeFile;        // Backing file when loaded with --load
+    const char* mazeFilePath;       // NULL = generate a new maze
     InputManager input;
     
     // Entities
@@ -179,35 +251,121 @@ public:
     Light mainLight;
     Light playerLight;
     
+    // Torches: chosen cells, and their lights binned per cell
+    std::vector<int> torchCells;
+    LightGrid lightGrid;
+    bool torchesEnabled;
+    
+    // Cells the player light can see (shadowcast from its cell)
+    ShadowMask playerShadow;
+    bool shadowsEnabled;
+    
     // Materials
     Material wallMaterial;
     Material floorMaterial;
     Material exitMaterial;
     
+    // Interned ids for submitted draws, valid with every backend
+    MaterialTable materials;
+    int floorMaterialId;
+    int wallMaterialId;
+    int exitOpenMaterialId;
+    int exitClosedMaterialId;
+    int monsterMaterialId;
+    int spikeMaterialId;
+    int keyMaterialId;
+    int torchMaterialId;
+    
+    // Where the scene is drawn; chosen with --renderer, cycled with R
+    WorkerPool workers;
+    RenderBackends backends;
+    RenderBackend* backend;
+    LodView lodView;                // Refreshed at the start of each frame
+    ViewWedge frameView;            // Likewise, for cell culling
+    float curveTime;                // Bezier animation time of this frame
+    std::vector<Vec4> curve;        // Bezier path points, reused
+    
+    // Scene traversal is recorded by the workers, one buffer per job
+    // (cell column chunks, monster chunks, then everything else), and
+    // replayed in job order to the backend on this thread
+    static const int RECORD_CHUNKS = 4;
+    static const int RECORD_JOBS = 2 * RECORD_CHUNKS + 1;
+    CommandBuffer sceneCommands[RECORD_JOBS];
+    
+    // Per-pixel lighting in GLSL (compiled on first use)
+    PhongShader phongShader;
+    bool shaderLighting;
+    
     // Game state
     GameState state;
     
+    // Shifting walls mode
+    bool shiftingEnabled;
+    float shiftTimer;
+    std::vector<int> keepOpen;      // Cells a shift must leave open, reused
+    
     // Timing
     float lastTime;
     float deltaTime;
     
+    // Determinism: one RNG seed per session, simulation counted in ticks
+    unsigned int seed;
+    unsigned int tick;
+    InputRecorder recorder;
+    InputReplayer replayer;
+    double simTimeMs;               // Wall time spent in update() so far
+    float lastTickMs;               // Wall time of the latest update()
+    
+    // Minimap
+    Minimap minimap;
+    bool showMinimap;
+    
+    // Performance overlay
+    FrameStats frameStats;
+    bool showStats;
+    const char* statsCsvPath;       // Written on exit when set
+    
+    // Heap allocations per frame; the guard is armed by --assert-no-alloc
+    AllocZone renderAllocs;
+    AllocZone simAllocs;            // Sim ticks since the last frame
+    AllocGuard allocGuard;
+    
     // Window
     int windowWidth;
     int windowHeight;
+    PointBuffer crosshair;          // Rasterized once per window size
     
-    Game() {
+    Game() : backends(&materials, &workers) {
         windowWidth = Config::WINDOW_WIDTH;
         windowHeight = Config::WINDOW_HEIGHT;
         state = STATE_PLAYING;
         lastTime = 0;
         deltaTime = 0;
+        shiftingEnabled = false;
+        shiftTimer = 0;
+        keepOpen.reserve(10);           // 3x3 around the player plus the key
+        generator = findGenerator("backtracker");
+        mazeFilePath = NULL;
+        seed = (unsigned int)time(NULL);
+        tick = 0;
+        simTimeMs = 0;
+        lastTickMs = 0;
+        showStats = false;
+        showMinimap = true;
+        
+        backend = &backends.immediate;
+        shaderLighting = false;
+        torchesEnabled = true;
+        shadowsEnabled = true;
+        statsCsvPath = NULL;
     }
     
     // ========================================================================
     // INITIALIZATION
     // ========================================================================
     void init() {
-        srand((unsigned int)time(NULL));
+        srand(seed);
+        tick = 0;
         
         initMaterials();
         initLights();
@@ -218,29 +376,34 @@ public:
         state = STATE_PLAYING;
     }
     
+    // Random empty cell, away from the start when possible. False if the
+    // maze has no empty cell at all.
+    bool randomSpawnCell(int& x, int& z) const {
+        return maze.getRandomEmptyCellAwayFromStart(3, x, z) || maze.getRandomEmptyCell(x, z);
+    }
+    
     void initEntities() {
         monsters.clear();
         hasKey = false;
         key.collected = false;
         
-        // Spawn monsters in random empty cells
-        for (int i = 0; i < 5; i++) { // 5 monsters
+        // Spawn monsters in random empty cells, not too close to start
+        const int monsterCount = 5;
+        monsters.reserve(monsterCount);
+        for (int i = 0; i < monsterCount; i++) {
             int x, z;
-            maze.getRandomEmptyCell(x, z);
+            if (!randomSpawnCell(x, z)) break;
             Vec4 pos = maze.gridToWorld(x, z);
-            // Ensure not too close to start
-            if (abs(x - maze.startX) > 2 || abs(z - maze.startZ) > 2) {
-                monsters.push_back(Monster(pos.x, pos.z));
-            } else {
-                i--; // Try again
-            }
+            monsters.push_back(Monster(pos.x, pos.z));
         }
         
-        // Spawn key
-        int kx, kz;
-        do {
-            maze.getRandomEmptyCell(kx, kz);
-        } while ((abs(kx - maze.startX) < 3 && abs(kz - maze.startZ) < 3) || (kx == maze.exitX && kz == maze.exitZ));
+        // Spawn key at the file's preset cell, or randomly (the exit is
+        // never an empty cell); with no empty cell at all it waits at the start
+        int kx = maze.keyX, kz = maze.keyZ;
+        if (maze.getCell(kx, kz) != CELL_EMPTY && !randomSpawnCell(kx, kz)) {
+            kx = maze.startX;
+            kz = maze.startZ;
+        }
         
         Vec4 keyPos = maze.gridToWorld(kx, kz);
         key.position = keyPos;
@@ -264,6 +427,41 @@ public:
         exitMaterial.diffuse = Color(1.0f, 0.85f, 0.0f);
         exitMaterial.specular = Color(1.0f, 1.0f, 0.5f);
         exitMaterial.shininess = 50.0f;
+        
+        // Entity materials are variations of the wall and exit materials
+        Material exitClosed = exitMaterial;
+        exitClosed.diffuse = Color(1.0f, 0.0f, 0.0f);      // Closed - Red
+        
+        Material monsterMat = wallMaterial;
+        monsterMat.diffuse = Color(1.0f, 0.0f, 0.0f);
+        monsterMat.ambient = Color(0.3f, 0.0f, 0.0f);
+        
+        Material spikeMat = wallMaterial;
+        spikeMat.diffuse = Color(1.0f, 1.0f, 0.0f);
+        spikeMat.ambient = Color(0.3f, 0.3f, 0.0f);
+        
+        Material goldMat = exitMaterial;
+        goldMat.diffuse = Color(1.0f, 0.8f, 0.0f);
+        goldMat.ambient = Color(0.4f, 0.3f, 0.0f);
+        goldMat.specular = Color(1.0f, 1.0f, 0.5f);
+        goldMat.shininess = 50.0f;
+        
+        MaterialTable& table = materials;
+        table.clear();
+        floorMaterialId = table.intern(floorMaterial);
+        wallMaterialId = table.intern(wallMaterial);
+        exitOpenMaterialId = table.intern(exitMaterial);
+        exitClosedMaterialId = table.intern(exitClosed);
+        monsterMaterialId = table.intern(monsterMat);
+        spikeMaterialId = table.intern(spikeMat);
+        keyMaterialId = table.intern(goldMat);
+        
+        // Torch heads glow through their ambient term
+        Material torchMat;
+        torchMat.ambient = Color(1.0f, 0.6f, 0.2f);
+        torchMat.diffuse = Color(0.3f, 0.2f, 0.1f);
+        torchMat.specular = Color(0.0f, 0.0f, 0.0f);
+        torchMaterialId = table.intern(torchMat);
     }
     
     void initLights() {
@@ -285,8 +483,73 @@ public:
         playerLight.isEnabled = true;
     }
     
+    // Spread TORCH_COUNT torches evenly over the open cells, in cell order
+    // (no rand(), so replays are unaffected)
+    void placeTorches() {
+        std::vector<int> open;
+        for (int z = 1; z < Maze::SIZE - 1; z++) {
+            for (int x = 1; x < Maze::SIZE - 1; x++) {
+                if (maze.getCell(x, z) == CELL_EMPTY) open.push_back(Maze::cellId(x, z));
+            }
+        }
+        torchCells.clear();
+        if (open.empty()) return;
+        int count = std::min((int)open.size(), Config::TORCH_COUNT);
+        for (int i = 0; i < count; i++) {
+            torchCells.push_back(open[(size_t)i * open.size() / count]);
+        }
+    }
+    
+    // Torches whose cell is open (shifts can wall them in), binned per cell
+    void rebuildLightGrid() {
+        std::vector<Light> torches;
+        for (size_t i = 0; i < torchCells.size(); i++) {
+            int x = torchCells[i] % Maze::SIZE, z = torchCells[i] / Maze::SIZE;
+            if (maze.getCell(x, z) == CELL_WALL) continue;
+            
+            Vec4 flame = maze.gridToWorld(x, z);
+            flame.y = Config::TORCH_HEIGHT;
+            torches.push_back(torchLight(flame));
+        }
+        lightGrid.build(torches, Maze::SIZE, Maze::SIZE, maze.cellSize, maze.offset);
+    }
+    
+    // Only a torch whose cell changed can have been walled in or freed
+    bool touchesTorch(const DirtyRect& changed) const {
+        for (size_t i = 0; i < torchCells.size(); i++) {
+            if (changed.contains(torchCells[i] % Maze::SIZE, torchCells[i] / Maze::SIZE)) return true;
+        }
+        return false;
+    }
+    
+    // Player light (shadowed by walls) plus the torches, when enabled
+    LightSet sceneLights() const {
+        return LightSet(playerLight, torchesEnabled ? &lightGrid : NULL,
+                        shadowsEnabled ? &playerShadow : NULL);
+    }
+    
     void initMaze() {
-        maze.generate();
+        // Remap the file each time so shifted walls are discarded
+        if (mazeFilePath && mazeFile.open(mazeFilePath) && maze.attachFile(mazeFile)) {
+            printf("Loaded maze from %s\n", mazeFilePath);
+        } else {
+            maze.generate(*generator, (unsigned int)rand());
+        }
+        maze.takeDirty();
+        minimap.rebuild(maze.walls, maze.exitX, maze.exitZ);
+        placeTorches();
+        rebuildLightGrid();
+        playerShadow.invalidate();
+        shiftTimer = 0;
+    }
+    
+    // Save the current layout (with key cell) to a .smaz file
+    bool saveMaze(const char* path) {
+        int kx, kz;
+        maze.worldToGrid(key.position, kx, kz);
+        bool ok = maze.saveToFile(path, kx, kz);
+        printf(ok ? "Saved maze to %s\n" : "Failed to save maze to %s\n", path);
+        return ok;
     }
     
     void initCamera() {
@@ -302,19 +565,32 @@ public:
     // UPDATE LOGIC
     // ========================================================================
     void update(float currentTime) {
+        AllocScope allocScope(simAllocs);
         deltaTime = currentTime - lastTime;
         lastTime = currentTime;
         
+        // Recording and replay advance by exactly one fixed tick per call
+        if (recorder.isRecording() || replayer.isActive()) {
+            deltaTime = 1.0f / Config::TARGET_FPS;
+        }
+        
+        if (replayer.isActive() && !feedReplayEvents()) return;
+        
+        std::chrono::steady_clock::time_point simStart = std::chrono::steady_clock::now();
+        tick++;
+        
         if (state != STATE_PLAYING) return;
         
         // Handle player movement
         updatePlayer();
         updateEntities();
+        updateShifting();
         
         // Check exit
         if (hasKey && maze.checkExit(camera.position)) {
             printf("You Win!\n");
             state = STATE_WIN;
+            allocGuard.restartWarmup();
             // Simple restart
             initMaze();
             initCamera();
@@ -325,6 +601,10 @@ public:
         // Update player light position
         playerLight.position = camera.position;
         playerLight.position.y += 0.5f;
+        
+        lastTickMs = (float)std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - simStart).count();
+        simTimeMs += lastTickMs;
     }
     
     void updatePlayer() {
@@ -388,115 +668,358 @@ public:
         }
     }
     
+    // ========================================================================
+    // SHIFTING WALLS
+    // ========================================================================
+    void updateShifting() {
+        if (!shiftingEnabled) return;
+        
+        shiftTimer += deltaTime;
+        if (shiftTimer < Config::SHIFT_INTERVAL) return;
+        shiftTimer = 0;
+        
+        shiftMaze();
+    }
+    
+    // Re-carve one random block of rooms. Only the block's cells change;
+    // the player's surroundings and the key must stay open and reachable.
+    void shiftMaze() {
+        keepOpen.clear();
+        
+        int px, pz;
+        maze.worldToGrid(camera.position, px, pz);
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                int cell = maze.getCell(px + dx, pz + dz);
+                if (cell != CELL_WALL) keepOpen.push_back(Maze::cellId(px + dx, pz + dz));
+            }
+        }
+        
+        if (!hasKey) {
+            int kx, kz;
+            maze.worldToGrid(key.position, kx, kz);
+            keepOpen.push_back(Maze::cellId(kx, kz));
+        }
+        
+        int rooms = std::min(Config::SHIFT_REGION_ROOMS, Maze::roomCount());
+        int range = Maze::roomCount() - rooms + 1;
+        
+        for (int attempt = 0; attempt < Config::SHIFT_ATTEMPTS; attempt++) {
+            if (maze.recarveRegion(rand() % range, rand() % range, rooms, keepOpen)) {
+                onMazeChanged(maze.takeDirty());
+                return;
+            }
+        }
+        maze.takeDirty();
+    }
+    
+    // Refresh whatever depends on the cells inside the changed box
+    void onMazeChanged(const DirtyRect& changed) {
+        minimap.update(maze.walls, changed.x0, changed.z0, changed.x1, changed.z1);
+        if (touchesTorch(changed)) {
+            allocGuard.restartWarmup(); // The light grid rebuild allocates
+            rebuildLightGrid();
+        }
+        playerShadow.invalidate();
+        
+        // Monsters caught inside new walls move to a free cell
+        for (auto& monster : monsters) {
+            int mx, mz;
+            maze.worldToGrid(monster.position, mx, mz);
+            if (!changed.touches(mx, mz, 1)) continue;
+            
+            int x, z;
+            if (maze.checkCollision(monster.position, monster.radius) && randomSpawnCell(x, z)) {
+                Vec4 pos = maze.gridToWorld(x, z);
+                monster.position.x = pos.x;
+                monster.position.z = pos.z;
+            }
+        }
+    }
+    
     // ========================================================================
     // RENDERING
     // ========================================================================
     void render() {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        frameStats.beginFrame();
+        renderAllocs.reset();
+        renderAllocs.begin();
+        frameArena().reset();
         
-        setupProjection();
-        setupCamera();
         setupLights();
+        if (shadowsEnabled) {
+            playerShadow.update(maze.walls, maze.offset, maze.cellSize,
+                                playerLight.position, playerLight.range(LIGHT_CUTOFF));
+        }
         
-        drawFloor();
-        drawMaze();
-        drawEntities();
+        backend->beginFrame(frameSetup());
+        recordScene();
+        for (int i = 0; i < RECORD_JOBS; i++) sceneCommands[i].replay(*backend);
+        backend->endFrame();
         
         drawHUD();
+        renderAllocs.end();
+        
+        FrameCounters& counters = frameCounters();
+        counters.arenaBytes = (unsigned int)frameArena().bytesUsed();
+        counters.arenaOverflows = frameArena().heapAllocations();
+        counters.heapAllocations = renderAllocs.allocations;
+        counters.heapBytes = (unsigned int)renderAllocs.bytes;
+        counters.simAllocations = simAllocs.allocations;
+        frameStats.endFrame(lastTickMs);
         
+        allocGuard.check("sim tick", simAllocs);
+        allocGuard.check("render", renderAllocs);
+        allocGuard.nextFrame();
+        simAllocs.reset();
         glutSwapBuffers();
     }
     
+    // Camera, lights, window and fog for this frame
+    FrameSetup frameSetup() {
+        FrameSetup frame;
+        frame.projection = projectionMatrix();
+        frame.view = viewMatrix();
+        frame.viewPos = camera.position;
+        frame.lights = sceneLights();
+        frame.width = windowWidth;
+        frame.height = windowHeight;
+        frame.clearColor = Color(Config::SKY_COLOR[0], Config::SKY_COLOR[1], Config::SKY_COLOR[2]);
+        frame.fogColor = frame.clearColor;
+        frame.fogDensity = Config::FOG_DENSITY;
+        return frame;
+    }
+    
+    struct RecordJob {
+        Game* game;
+        explicit RecordJob(Game* g) : game(g) {}
+        void operator()(int job) { game->recordJob(job); }
+    };
+    
+    // Fill sceneCommands in parallel. Everything the jobs share is set up
+    // here first; each job then only writes its own buffer and entities.
+    void recordScene() {
+        lodView = LodView(camera.position, Config::FOV, windowHeight);
+        frameView = camera.getViewWedge(Config::FOV, (float)windowWidth / windowHeight,
+                                        Config::FAR_PLANE);
+        curveTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+        
+        RecordJob job(this);
+        workers.parallelFor(RECORD_JOBS, job);
+    }
+    
+    void recordJob(int job) {
+        CommandBuffer& out = sceneCommands[job];
+        out.clear();
+        if (job < RECORD_CHUNKS) {
+            int x0 = job * Maze::SIZE / RECORD_CHUNKS;
+            int x1 = (job + 1) * Maze::SIZE / RECORD_CHUNKS;
+            drawFloor(out, x0, x1);
+            drawMaze(out, x0, x1);
+        } else if (job < 2 * RECORD_CHUNKS) {
+            int chunk = job - RECORD_CHUNKS;
+            int count = (int)monsters.size();
+            drawMonsters(out, chunk * count / RECORD_CHUNKS, (chunk + 1) * count / RECORD_CHUNKS);
+        } else {
+            drawEntities(out);
+        }
+    }
+    
+    int recordedCommands() const {
+        int n = 0;
+        for (int i = 0; i < RECORD_JOBS; i++) n += sceneCommands[i].commandCount();
+        return n;
+    }
+    
     // Draw 2D HUD using CG.3 Algorithms
     void drawHUD() {
-        // Switch to 2D Orthographic projection
-        glMatrixMode(GL_PROJECTION);
-        glPushMatrix();
-        glLoadIdentity();
-        gluOrtho2D(0, windowWidth, 0, windowHeight);
+        backend->beginHud();
         
-        glMatrixMode(GL_MODELVIEW);
-        glPushMatrix();
-        glLoadIdentity();
+        // Crosshair pixels come from buildCrosshair()
+        if (crosshair.empty()) buildCrosshair();
+        backend->hudPoints(crosshair, Color(0.0f, 1.0f, 0.0f));
         
-        glDisable(GL_LIGHTING);
-        glDisable(GL_DEPTH_TEST);
+        if (showMinimap) drawMinimap();
+        if (showStats) drawStatsOverlay();
         
-        // Draw Crosshair using Bresenham Line (CG.3)
-        glColor3f(0.0f, 1.0f, 0.0f);
+        backend->endHud();
+    }
+    
+    // Rasterize the crosshair for the current window size
+    void buildCrosshair() {
         int cx = windowWidth / 2;
         int cy = windowHeight / 2;
         int size = 10;
         
-        drawLineBresenham(cx - size, cy, cx + size, cy);
-        drawLineBresenham(cx, cy - size, cx, cy + size);
+        crosshair.clear();
         
-        // Draw Circle around crosshair using Midpoint Circle (CG.3)
-        drawCircleMidpoint(cx, cy, size + 5);
+        // Crosshair using Bresenham Line (CG.3)
+        rasterLineBresenham(cx - size, cy, cx + size, cy, crosshair);
+        rasterLineBresenham(cx, cy - size, cx, cy + size, crosshair);
         
-        // Restore 3D state
-        glEnable(GL_DEPTH_TEST);
-        // glEnable(GL_LIGHTING); // Manual lighting used
+        // Circle around crosshair using Midpoint Circle (CG.3)
+        rasterCircleMidpoint(cx, cy, size + 5, crosshair);
+    }
+    
+    // Cached maze texture plus live markers (bottom left)
+    void drawMinimap() {
+        minimap.draw(Config::MINIMAP_X, Config::MINIMAP_Y, Config::MINIMAP_SIZE);
         
-        glMatrixMode(GL_PROJECTION);
-        glPopMatrix();
-        glMatrixMode(GL_MODELVIEW);
-        glPopMatrix();
+        float px = (camera.position.x - maze.offset.x) / maze.cellSize;
+        float pz = (camera.position.z - maze.offset.z) / maze.cellSize;
+        Vec4 forward = camera.getForward();
+        
+        glPointSize(4.0f);
+        glBegin(GL_POINTS);
+        glColor3f(1.0f, 0.0f, 0.0f);
+        for (size_t i = 0; i < monsters.size(); i++) {
+            minimap.marker((monsters[i].position.x - maze.offset.x) / maze.cellSize,
+                           (monsters[i].position.z - maze.offset.z) / maze.cellSize);
+        }
+        if (!hasKey) {
+            glColor3f(1.0f, 1.0f, 0.0f);
+            minimap.marker((key.position.x - maze.offset.x) / maze.cellSize,
+                           (key.position.z - maze.offset.z) / maze.cellSize);
+        }
+        glColor3f(0.2f, 0.6f, 1.0f);
+        minimap.marker(px, pz);
+        glEnd();
+        glPointSize(1.0f);
+        
+        // Facing direction
+        glBegin(GL_LINES);
+        minimap.marker(px, pz);
+        minimap.marker(px + forward.x, pz + forward.z);
+        glEnd();
     }
     
-    void drawEntities() {
-        for (auto& monster : monsters) {
-            monster.draw(camera.position, playerLight, wallMaterial);
+    // Frame-time text, percentiles, histogram and counters (top left)
+    void drawStatsOverlay() {
+        frameStats.summarize();
+        if (frameStats.empty()) return;
+        const FrameSample& last = frameStats.latest();
+        
+        const int lineHeight = 15;
+        int x = 10;
+        int y = windowHeight - 20;
+        char line[128];
+        
+        glColor3f(1.0f, 1.0f, 1.0f);
+        snprintf(line, sizeof(line), "FPS %.1f  avg %.2f ms  max %.2f ms",
+                 frameStats.fps, frameStats.averageMs, frameStats.maxMs);
+        drawText(x, y, line); y -= lineHeight;
+        snprintf(line, sizeof(line), "p50 %.2f  p95 %.2f  p99 %.2f ms",
+                 frameStats.p50, frameStats.p95, frameStats.p99);
+        drawText(x, y, line); y -= lineHeight;
+        snprintf(line, sizeof(line), "sim tick %.3f ms", last.simMs);
+        drawText(x, y, line); y -= lineHeight;
+        snprintf(line, sizeof(line), "vertices %u  lighting evals %u",
+                 last.counters.vertices, last.counters.lightingEvals);
+        drawText(x, y, line); y -= lineHeight;
+        snprintf(line, sizeof(line), "cells drawn %u  culled %u  lit %d",
+                 last.counters.cellsDrawn, last.counters.cellsCulled,
+                 shadowsEnabled ? playerShadow.litCount() : Maze::SIZE * Maze::SIZE);
+        drawText(x, y, line); y -= lineHeight;
+        if (allocationsTracked()) {
+            snprintf(line, sizeof(line), "heap allocs %u (%u B)  sim %u  arena %u KB +%u",
+                     last.counters.heapAllocations, last.counters.heapBytes,
+                     last.counters.simAllocations, last.counters.arenaBytes / 1024,
+                     last.counters.arenaOverflows);
+        } else {
+            snprintf(line, sizeof(line), "heap allocs untracked  arena %u KB +%u",
+                     last.counters.arenaBytes / 1024, last.counters.arenaOverflows);
+        }
+        drawText(x, y, line); y -= lineHeight;
+        snprintf(line, sizeof(line), "backend %s  recorded %d  batches %d  lighting %s",
+                 backend->name(), recordedCommands(), backend->batchCount,
+                 shaderLighting ? "shader" : "CPU");
+        drawText(x, y, line); y -= lineHeight;
+        if (backend == &backends.software) {
+            const SoftRasterizer& raster = backends.software.raster;
+            snprintf(line, sizeof(line), "triangles %d  binned %d  threads %d",
+                     raster.trianglesSubmitted, raster.trianglesBinned, workers.threadCount());
+            drawText(x, y, line); y -= lineHeight;
         }
         
+        // Histogram: one bar per STATS_HISTOGRAM_MS bucket, scaled to the peak
+        const int barWidth = 8;
+        const int maxBarHeight = 40;
+        int base = y - maxBarHeight - 5;
+        glColor3f(0.3f, 0.8f, 1.0f);
+        glBegin(GL_QUADS);
+        for (int i = 0; i < STATS_HISTOGRAM_BINS; i++) {
+            if (frameStats.histogram[i] == 0) continue;
+            int h = std::max(1, frameStats.histogram[i] * maxBarHeight / frameStats.histogramPeak);
+            int bx = x + i * barWidth;
+            glVertex2i(bx, base);
+            glVertex2i(bx + barWidth - 1, base);
+            glVertex2i(bx + barWidth - 1, base + h);
+            glVertex2i(bx, base + h);
+            countVertices(4);
+        }
+        glEnd();
+        
+        glColor3f(0.7f, 0.7f, 0.7f);
+        snprintf(line, sizeof(line), "0 .. %.0f+ ms",
+                 STATS_HISTOGRAM_MS * (STATS_HISTOGRAM_BINS - 1));
+        drawText(x, base - lineHeight, line);
+    }
+    
+    void drawMonsters(CommandBuffer& out, int first, int last) {
+        for (int i = first; i < last; i++) {
+            monsters[i].draw(out, monsterMaterialId, spikeMaterialId, lodView);
+        }
+    }
+    
+    // Key, torches and the Bezier path
+    void drawEntities(CommandBuffer& out) {
         if (!hasKey) {
-            key.draw(camera.position, playerLight, exitMaterial); // Use exit material (gold)
+            key.draw(out, keyMaterialId, lodView);
+        }
+        
+        if (torchesEnabled) {
+            for (int i = 0; i < lightGrid.lightCount(); i++) {
+                const Vec4& p = lightGrid.light(i).position;
+                out.pushCube(torchMaterialId,
+                             createTranslationMatrix(p.x, p.y, p.z) * createScaleMatrix(0.15f, 0.15f, 0.15f));
+            }
         }
         
         // Draw a magic Bezier path above the maze (CG.5)
-        glColor3f(0.5f, 0.0f, 1.0f);
-        glLineWidth(3.0f);
         Vec4 p0(0, 5, 0);
         Vec4 p1(5, 8, 5);
         Vec4 p2(10, 4, -5);
         Vec4 p3(15, 6, 0);
         
         // Animate control points slightly
-        float t = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
-        p1.y += sin(t) * 2.0f;
-        p2.y += cos(t) * 2.0f;
+        p1.y += sin(curveTime) * 2.0f;
+        p2.y += cos(curveTime) * 2.0f;
         
-        drawBezierCurve(p0, p1, p2, p3, 50);
-        glLineWidth(1.0f);
+        const int segments = 50;
+        curve.resize(segments + 1);
+        for (int i = 0; i <= segments; i++) {
+            curve[i] = bezierPoint(p0, p1, p2, p3, (float)i / segments);
+        }
+        out.drawLines(&curve[0], (int)curve.size(), Color(0.5f, 0.0f, 1.0f), 3.0f);
     }
     
-    void setupProjection() {
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        
-        // Use custom matrix implementation instead of gluPerspective
-        Matrix4x4 projMat = createPerspectiveMatrix(
+    // Use custom matrix implementation instead of gluPerspective
+    Matrix4x4 projectionMatrix() const {
+        return createPerspectiveMatrix(
             Config::FOV, 
             (float)windowWidth / windowHeight, 
             Config::NEAR_PLANE, 
             Config::FAR_PLANE
         );
-        
-        glLoadMatrixf(projMat.ptr());
     }
     
-    void setupCamera() {
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        
-        // Use custom matrix implementation instead of gluLookAt
-        Matrix4x4 viewMat = createLookAtMatrix(
+    // Use custom matrix implementation instead of gluLookAt
+    Matrix4x4 viewMatrix() const {
+        return createLookAtMatrix(
             camera.position,
             camera.lookAt,
             camera.up
         );
-        
-        glLoadMatrixf(viewMat.ptr());
     }
     
     void setupLights() {
@@ -531,90 +1054,228 @@ public:
     // ========================================================================
     // DRAW FLOOR
     // ========================================================================
-    void drawFloor() {
-        float size = Maze::SIZE * maze.cellSize;
-        float y = 0.0f;
-        
-        // Manual lighting for floor
-        Vec4 normal(0, 1, 0);
-        Vec4 p1(maze.offset.x, y, maze.offset.z);
-        Vec4 p2(maze.offset.x + size, y, maze.offset.z);
-        Vec4 p3(maze.offset.x + size, y, maze.offset.z + size);
-        Vec4 p4(maze.offset.x, y, maze.offset.z + size);
-        
-        // Use player light for dynamic lighting
-        Color c1 = calculateLighting(p1, normal, camera.position, playerLight, floorMaterial);
-        Color c2 = calculateLighting(p2, normal, camera.position, playerLight, floorMaterial);
-        Color c3 = calculateLighting(p3, normal, camera.position, playerLight, floorMaterial);
-        Color c4 = calculateLighting(p4, normal, camera.position, playerLight, floorMaterial);
-        
-        glBegin(GL_QUADS);
-        glNormal3f(0, 1, 0);
-        
-        glColor3f(c1.r, c1.g, c1.b);
-        glVertex3f(p1.x, p1.y, p1.z);
+    // One lit quad per visible open cell in columns [x0, x1), so torchlight
+    // and shadows show up on the floor (both are looked up per cell)
+    void drawFloor(CommandBuffer& out, int x0, int x1) {
+        float cellRadius = maze.cellSize * 0.7072f;
+        FrameCounters& counters = out.counters;
         
-        glColor3f(c2.r, c2.g, c2.b);
-        glVertex3f(p2.x, p2.y, p2.z);
-        
-        glColor3f(c3.r, c3.g, c3.b);
-        glVertex3f(p3.x, p3.y, p3.z);
-        
-        glColor3f(c4.r, c4.g, c4.b);
-        glVertex3f(p4.x, p4.y, p4.z);
-        glEnd();
+        for (int x = x0; x < x1; x++) {
+            for (int z = 0; z < Maze::SIZE; z++) {
+                int cell = maze.getCell(x, z);
+                if (cell == CELL_WALL) continue;
+                
+                // drawMaze counts the exit cell with its gate
+                Vec4 c = maze.gridToWorld(x, z);
+                if (!frameView.isColumnVisible(c.x, c.z, cellRadius)) {
+                    if (cell != CELL_EXIT) counters.cellsCulled++;
+                    continue;
+                }
+                if (cell != CELL_EXIT) counters.cellsDrawn++;
+                
+                out.submit(floorMaterialId, MESH_QUAD,
+                           createTranslationMatrix(c.x, 0, c.z) *
+                           createScaleMatrix(maze.cellSize, 1.0f, maze.cellSize));
+            }
+        }
     }
     
     // ========================================================================
     // DRAW MAZE
     // ========================================================================
-    void drawMaze() {
+    // Record the visible wall and exit columns in [x0, x1)
+    void drawMaze(CommandBuffer& out, int x0, int x1) {
         float wallHeight = Config::WALL_HEIGHT;
         float wallWidth = maze.cellSize; // Full width to avoid gaps
         
+        // Skip columns outside the view (radius covers the cell's corners)
+        float cellRadius = maze.cellSize * 0.7072f;
+        FrameCounters& counters = out.counters;
+        
         // Static walls
-        for (int x = 0; x < Maze::SIZE; x++) {
+        for (int x = x0; x < x1; x++) {
             for (int z = 0; z < Maze::SIZE; z++) {
                 int cell = maze.getCell(x, z);
+                if (cell != CELL_WALL && cell != CELL_EXIT) continue;
                 
-                if (cell == CELL_WALL) {
-                    Vec4 pos = maze.gridToWorld(x, z);
-                    drawCube(pos.x, wallHeight / 2, pos.z, wallWidth, wallHeight, wallWidth,
-                             camera.position, playerLight, wallMaterial);
+                Vec4 pos = maze.gridToWorld(x, z);
+                if (!frameView.isColumnVisible(pos.x, pos.z, cellRadius)) {
+                    counters.cellsCulled++;
+                    continue;
                 }
-                else if (cell == CELL_EXIT) {
-                    Vec4 pos = maze.gridToWorld(x, z);
-                    
-                    Material mat = exitMaterial;
-                    if (!hasKey) {
-                        // Closed - Red
-                        mat.diffuse = Color(1.0f, 0.0f, 0.0f);
-                    }
-                    
-                    drawCube(pos.x, wallHeight / 2, pos.z, wallWidth, wallHeight, wallWidth,
-                             camera.position, playerLight, mat);
+                counters.cellsDrawn++;
+                
+                int material = wallMaterialId;
+                if (cell == CELL_EXIT) {
+                    material = hasKey ? exitOpenMaterialId : exitClosedMaterialId;
                 }
+                
+                Matrix4x4 M = createTranslationMatrix(pos.x, wallHeight / 2, pos.z) *
+                              createScaleMatrix(wallWidth, wallHeight, wallWidth);
+                out.pushCube(material, M);
             }
         }
     }
-
+    
+    // ========================================================================
+    // RECORD / REPLAY
+    // ========================================================================
+    bool startRecording(const char* path) {
+        return recorder.open(path, seed, Config::TARGET_FPS);
+    }
+    
+    // Load a replay; its seed replaces ours, so call before init()
+    bool startReplay(const char* path) {
+        if (!replayer.load(path)) return false;
+        seed = replayer.header.seed;
+        return true;
+    }
+    
+    // Apply this tick's recorded events. Returns false when the replay ended.
+    bool feedReplayEvents() {
+        while (const ReplayEvent* e = replayer.next(tick)) {
+            switch (e->type) {
+                case EVENT_KEY_DOWN:   handleKeyDown((unsigned char)e->key); break;
+                case EVENT_KEY_UP:     handleKeyUp((unsigned char)e->key); break;
+                case EVENT_MOUSE_MOVE: handleMouseMove(e->x, e->y); break;
+                case EVENT_MOUSE_WARP: handleMouseWarp(); break;
+                case EVENT_END:
+                    finishReplay();
+                    return false;
+            }
+        }
+        if (replayer.isExhausted()) {
+            finishReplay();
+            return false;
+        }
+        return true;
+    }
+    
+    void finishReplay() {
+        replayer.stop();
+        printf("Replay finished: %u ticks, state hash %08x, sim %.3f ms/tick\n",
+               tick, stateHash(), tick ? simTimeMs / tick : 0.0);
+        shutdown();
+        exit(0);
+    }
+    
+    // FNV-1a over everything the simulation owns
+    unsigned int stateHash() const {
+        unsigned int h = 2166136261u;
+        hashBytes(h, &camera.position, sizeof(Vec4));
+        hashBytes(h, &camera.theta, sizeof(float));
+        hashBytes(h, &camera.phi, sizeof(float));
+        for (size_t i = 0; i < monsters.size(); i++) {
+            hashBytes(h, &monsters[i].position, sizeof(Vec4));
+        }
+        hashBytes(h, &hasKey, sizeof(bool));
+        hashBytes(h, maze.grid, sizeof(maze.grid));
+        return h;
+    }
+    
+    static void hashBytes(unsigned int& h, const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            h = (h ^ p[i]) * 16777619u;
+        }
+    }
+    
+    // Flush anything that must survive exit
+    void shutdown() {
+        recorder.close(tick);
+        if (statsCsvPath) frameStats.writeCsv(statsCsvPath);
+    }
     
     // ========================================================================
     // INPUT HANDLING
     // ========================================================================
+    
+    // Switch lighting between the CPU and the shader; stays on the CPU if
+    // the shader cannot be built or the backend cannot use it
+    void setShaderLighting(bool enabled) {
+        if (enabled && !phongShader.init()) enabled = false;
+        if (!backend->setShader(enabled ? &phongShader : NULL)) {
+            printf("The %s backend has no shader lighting\n", backend->name());
+            backend->setShader(NULL);
+            enabled = false;
+        }
+        shaderLighting = enabled;
+        printf("Lighting: %s\n", enabled ? "per-pixel shader" : "CPU");
+    }
+    
+    // Draw through another backend, keeping the lighting choice if it can
+    void setBackend(RenderBackend* next) {
+        backend->setShader(NULL);
+        backend = next;
+        printf("Renderer: %s", backend->name());
+        if (backend == &backends.software) {
+            printf(" (%d threads, %dx%d tiles)", workers.threadCount(), RASTER_TILE, RASTER_TILE);
+        }
+        printf("\n");
+        if (shaderLighting) setShaderLighting(true);
+    }
+    
     void handleKeyDown(unsigned char key) {
-        input.keyDown(key);
-        
         if (key == 27) { // ESC
+            shutdown();
             exit(0);
         }
+        
+        recorder.record(tick, EVENT_KEY_DOWN, key, 0, 0);
+        input.keyDown(key);
+        allocGuard.restartWarmup();     // Toggles may fill caches
+        
+        if (key == 'f' || key == 'F') {
+            showStats = !showStats;
+        }
+        
+        if (key == 'l' || key == 'L') {
+            setShaderLighting(!shaderLighting);
+        }
+        
+        if (key == 't' || key == 'T') {
+            torchesEnabled = !torchesEnabled;
+            printf("Torches: %s (%d lights)\n", torchesEnabled ? "on" : "off", lightGrid.lightCount());
+        }
+        
+        if (key == 'h' || key == 'H') {
+            shadowsEnabled = !shadowsEnabled;
+            playerShadow.invalidate();
+            printf("Wall shadows: %s\n", shadowsEnabled ? "on" : "off");
+        }
+        
+        if (key == 'r' || key == 'R') {
+            setBackend(backends.next(backend));
+        }
+        
+        if ((key == 'p' || key == 'P') && backend == &backends.software) {
+            if (backends.software.target.savePPM("frame.ppm")) printf("Saved frame.ppm\n");
+        }
+        
+        if (key == 'n' || key == 'N') {
+            showMinimap = !showMinimap;
+        }
+        
+        if (key == 'm' || key == 'M') {
+            shiftingEnabled = !shiftingEnabled;
+            shiftTimer = 0;
+            printf("Shifting walls: %s\n", shiftingEnabled ? "ON" : "OFF");
+        }
     }
     
     void handleKeyUp(unsigned char key) {
+        recorder.record(tick, EVENT_KEY_UP, key, 0, 0);
         input.keyUp(key);
     }
     
+    // The pointer is about to be warped back to the window center
+    void handleMouseWarp() {
+        recorder.record(tick, EVENT_MOUSE_WARP, 0, 0, 0);
+        input.prepareForWarp();
+    }
+    
     void handleMouseMove(int x, int y) {
+        recorder.record(tick, EVENT_MOUSE_MOVE, 0, x, y);
         if (state == STATE_PLAYING) {
             input.mouseMove(x, y);
             
@@ -633,6 +1294,8 @@ public:
         windowHeight = h;
         glViewport(0, 0, w, h);
         input.setWindowCenter(w / 2, h / 2);
+        buildCrosshair();
+        allocGuard.restartWarmup();
     }
     
     void printWelcome() {
@@ -642,6 +1305,14 @@ public:
         printf("Controls:\n");
         printf("  W/A/S/D - Move\n");
         printf("  Mouse   - Look around\n");
+        printf("  M       - Toggle shifting walls\n");
+        printf("  N       - Toggle minimap\n");
+        printf("  L       - Toggle per-pixel shader lighting\n");
+        printf("  T       - Toggle torches\n");
+        printf("  H       - Toggle wall shadows\n");
+        printf("  R       - Next renderer (immediate, retained, instanced, software)\n");
+        printf("  P       - Save software frame to frame.ppm\n");
+        printf("  F       - Toggle frame stats overlay\n");
         printf("  ESC     - Exit\n");
         printf("==============================================\n");
         printf("Objective: Find the exit!\n");
@@ -0,0 +1,404 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Maze Generators Header
+ *
+ * Perfect-maze generators behind a common interface:
+ * - Recursive Backtracker (DFS, explicit stack)
+ * - Randomized Kruskal (union-find over rooms)
+ * - Wilson's algorithm (loop-erased random walks, uniform spanning tree)
+ * - Eller's algorithm (row by row, O(width) memory, streams rows out)
+ *
+ * Layout matches Maze: rooms sit on odd (x, z), passages between them,
+ * everything else is wall. Output is a BitGrid (1 = wall) or a stream
+ * of bit-packed rows for mazes too large to keep in memory. With
+ * trackRegions, carved cells are united in a DisjointSet as they open.
+ ******************************************************************************/
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include "bitgrid.h"
+#include "cellindex.h"
+#include "disjointset.h"
+
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+// ============================================================================
+// ROW SINK - Receives a maze one row at a time
+// Each row is BitGrid::strideFor(width) words, bit x = cell x (1 = wall).
+// ============================================================================
+class MazeRowSink {
+public:
+    virtual ~MazeRowSink() {}
+    virtual void beginMaze(int width, int height) { (void)width; (void)height; }
+    virtual void writeRow(int z, const uint64_t* row) = 0;
+    virtual void endMaze() {}
+};
+
+// Copies streamed rows into a BitGrid
+class BitGridRowSink : public MazeRowSink {
+public:
+    BitGrid& grid;
+
+    BitGridRowSink(BitGrid& g) : grid(g) {}
+
+    void beginMaze(int width, int height) {
+        if (grid.width != width || grid.height != height) grid.resize(width, height);
+    }
+
+    void writeRow(int z, const uint64_t* row) {
+        memcpy(grid.row(z), row, grid.wordsPerRow * sizeof(uint64_t));
+    }
+};
+
+// Copies streamed rows into a BitGrid and unites each open cell with its
+// open neighbours to the left and in the row above (already written)
+class RegionRowSink : public BitGridRowSink {
+public:
+    DisjointSet& regions;
+
+    RegionRowSink(BitGrid& g, DisjointSet& sets) : BitGridRowSink(g), regions(sets) {}
+
+    void writeRow(int z, const uint64_t* row) {
+        BitGridRowSink::writeRow(z, row);
+        for (int x = 0; x < grid.width; x++) {
+            if (grid.isWall(x, z)) continue;
+            int id = z * grid.width + x;
+            if (x > 0 && !grid.isWall(x - 1, z)) regions.unite(id, id - 1);
+            if (z > 0 && !grid.isWall(x, z - 1)) regions.unite(id, id - grid.width);
+        }
+    }
+};
+
+// ============================================================================
+// GENERATOR INTERFACE
+// ============================================================================
+class MazeGenerator {
+public:
+    MazeGenerator() : regions(NULL) {}
+    virtual ~MazeGenerator() {}
+
+    // While set, generate() unites every cell it opens with its open
+    // neighbours in sets (cell id z * width + x, reset by the caller), so
+    // connectivity is known when carving ends without another pass
+    void trackRegions(DisjointSet* sets) { regions = sets; }
+
+    virtual const char* name() const = 0;
+
+    // Carve a perfect maze into grid (already sized; contents overwritten)
+    virtual void generate(BitGrid& grid) = 0;
+
+    // True if generateRows runs in O(width) memory
+    virtual bool isStreaming() const { return false; }
+
+    // Emit the maze row by row. Whole-grid generators build it first.
+    virtual void generateRows(int width, int height, MazeRowSink& sink) {
+        BitGrid grid;
+        grid.resize(width, height);
+        generate(grid);
+        sink.beginMaze(width, height);
+        for (int z = 0; z < height; z++) sink.writeRow(z, grid.row(z));
+        sink.endMaze();
+    }
+
+protected:
+    DisjointSet* regions;
+
+    static int roomsX(const BitGrid& g) { return (g.width - 1) / 2; }
+    static int roomsZ(const BitGrid& g) { return (g.height - 1) / 2; }
+
+    // Open cell (x, z), joining it to its open neighbours when tracking
+    void openCell(BitGrid& g, int x, int z) {
+        g.set(x, z, false);
+        if (!regions) return;
+        int id = z * g.width + x;
+        if (x > 0 && !g.isWall(x - 1, z)) regions->unite(id, id - 1);
+        if (x + 1 < g.width && !g.isWall(x + 1, z)) regions->unite(id, id + 1);
+        if (z > 0 && !g.isWall(x, z - 1)) regions->unite(id, id - g.width);
+        if (z + 1 < g.height && !g.isWall(x, z + 1)) regions->unite(id, id + g.width);
+    }
+
+    // Open room (rx, rz)
+    void openRoom(BitGrid& g, int rx, int rz) {
+        openCell(g, 2 * rx + 1, 2 * rz + 1);
+    }
+
+    // Open the passage between two adjacent rooms
+    void openPassage(BitGrid& g, int rx0, int rz0, int rx1, int rz1) {
+        openCell(g, rx0 + rx1 + 1, rz0 + rz1 + 1);
+    }
+};
+
+// ============================================================================
+// RECURSIVE BACKTRACKER
+// Long winding corridors, few dead ends. Memory: one stack entry per room.
+// ============================================================================
+class BacktrackerGenerator : public MazeGenerator {
+public:
+    const char* name() const { return "backtracker"; }
+
+    void generate(BitGrid& grid) {
+        grid.fill(true);
+        int rw = roomsX(grid), rh = roomsZ(grid);
+        if (rw <= 0 || rh <= 0) return;
+
+        std::vector<int> stack;
+        stack.push_back(0);
+        openRoom(grid, 0, 0);
+
+        const int dirs[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+
+        while (!stack.empty()) {
+            int rx = stack.back() % rw, rz = stack.back() / rw;
+
+            int options[4];
+            int count = 0;
+            for (int i = 0; i < 4; i++) {
+                int nx = rx + dirs[i][0], nz = rz + dirs[i][1];
+                if (nx >= 0 && nx < rw && nz >= 0 && nz < rh &&
+                    grid.isWall(2 * nx + 1, 2 * nz + 1)) {
+                    options[count++] = i;
+                }
+            }
+
+            if (count == 0) { stack.pop_back(); continue; }
+
+            int d = options[rand() % count];
+            int nx = rx + dirs[d][0], nz = rz + dirs[d][1];
+            openPassage(grid, rx, rz, nx, nz);
+            openRoom(grid, nx, nz);
+            stack.push_back(nz * rw + nx);
+        }
+    }
+};
+
+// ============================================================================
+// RANDOMIZED KRUSKAL
+// Shuffle every room-to-room edge, keep those joining two different sets.
+// Many short dead ends. Memory: edge list + union-find over rooms.
+// ============================================================================
+class KruskalGenerator : public MazeGenerator {
+public:
+    const char* name() const { return "kruskal"; }
+
+    void generate(BitGrid& grid) {
+        grid.fill(true);
+        int rw = roomsX(grid), rh = roomsZ(grid);
+        if (rw <= 0 || rh <= 0) return;
+
+        // Edge e: room id * 2 + (0 = to the right, 1 = below)
+        std::vector<int> edges;
+        edges.reserve((size_t)rw * rh * 2);
+        for (int rz = 0; rz < rh; rz++) {
+            for (int rx = 0; rx < rw; rx++) {
+                openRoom(grid, rx, rz);
+                int id = rz * rw + rx;
+                if (rx + 1 < rw) edges.push_back(id * 2);
+                if (rz + 1 < rh) edges.push_back(id * 2 + 1);
+            }
+        }
+
+        for (int i = (int)edges.size() - 1; i > 0; i--) {
+            std::swap(edges[i], edges[randomIndex(i + 1)]);
+        }
+
+        DisjointSet sets;
+        sets.reset(rw * rh);
+        for (size_t i = 0; i < edges.size(); i++) {
+            int a = edges[i] / 2;
+            int b = (edges[i] & 1) ? a + rw : a + 1;
+            if (sets.unite(a, b)) {
+                openPassage(grid, a % rw, a / rw, b % rw, b / rw);
+            }
+        }
+    }
+};
+
+// ============================================================================
+// WILSON'S ALGORITHM
+// Loop-erased random walks from each unvisited room until the walk hits
+// the tree. Produces a uniformly random spanning tree (unbiased maze).
+// Memory: one direction byte per room.
+// ============================================================================
+class WilsonGenerator : public MazeGenerator {
+public:
+    const char* name() const { return "wilson"; }
+
+    void generate(BitGrid& grid) {
+        grid.fill(true);
+        int rw = roomsX(grid), rh = roomsZ(grid);
+        if (rw <= 0 || rh <= 0) return;
+
+        const int dirs[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+        std::vector<unsigned char> walkDir((size_t)rw * rh, 0);
+
+        // Rooms already in the tree are open in grid
+        int first = randomIndex(rw * rh);
+        openRoom(grid, first % rw, first / rw);
+
+        for (int start = 0; start < rw * rh; start++) {
+            if (!grid.isWall(2 * (start % rw) + 1, 2 * (start / rw) + 1)) continue;
+
+            // Random walk; overwriting walkDir erases loops implicitly
+            int rx = start % rw, rz = start / rw;
+            while (grid.isWall(2 * rx + 1, 2 * rz + 1)) {
+                int d, nx, nz;
+                do {
+                    d = rand() % 4;
+                    nx = rx + dirs[d][0];
+                    nz = rz + dirs[d][1];
+                } while (nx < 0 || nx >= rw || nz < 0 || nz >= rh);
+                walkDir[rz * rw + rx] = (unsigned char)d;
+                rx = nx;
+                rz = nz;
+            }
+
+            // Retrace the loop-erased path, adding it to the tree
+            rx = start % rw;
+            rz = start / rw;
+            while (grid.isWall(2 * rx + 1, 2 * rz + 1)) {
+                int d = walkDir[rz * rw + rx];
+                int nx = rx + dirs[d][0], nz = rz + dirs[d][1];
+                openRoom(grid, rx, rz);
+                openPassage(grid, rx, rz, nx, nz);
+                rx = nx;
+                rz = nz;
+            }
+        }
+    }
+};
+
+// ============================================================================
+// ELLER'S ALGORITHM
+// Builds one row of rooms at a time, tracking only which rooms of the
+// current row share a set. Memory is O(width) regardless of height, so
+// rows can go straight to disk or chunked storage.
+// ============================================================================
+class EllerGenerator : public MazeGenerator {
+public:
+    const char* name() const { return "eller"; }
+
+    bool isStreaming() const { return true; }
+
+    void generate(BitGrid& grid) {
+        if (regions) {
+            RegionRowSink sink(grid, *regions);
+            generateRows(grid.width, grid.height, sink);
+            return;
+        }
+        BitGridRowSink sink(grid);
+        generateRows(grid.width, grid.height, sink);
+    }
+
+    void generateRows(int width, int height, MazeRowSink& sink) {
+        int rw = (width - 1) / 2, rh = (height - 1) / 2;
+
+        // Scratch row holding all-wall bits (padding bits stay clear)
+        BitGrid row;
+        row.resize(width, 1);
+        BitGrid wallRow;
+        wallRow.resize(width, 1);
+
+        std::vector<int> setId(rw > 0 ? rw : 1, -1);   // Set of each column
+        std::vector<int> parent(2 * rw + 1);           // Per-row union-find over ids
+        std::vector<int> members(2 * rw + 1);          // Columns per set
+        std::vector<unsigned char> carvedDown(2 * rw + 1);
+        std::vector<unsigned char> used(2 * rw + 1);
+        std::vector<unsigned char> down(rw > 0 ? rw : 1);
+
+        sink.beginMaze(width, height);
+        sink.writeRow(0, wallRow.row(0));
+
+        int z = 1;
+        for (int rz = 0; rz < rh; rz++) {
+            bool lastRow = (rz == rh - 1);
+
+            // 1. Columns without a set (not carved into from above) get a fresh id
+            std::fill(used.begin(), used.end(), 0);
+            for (int c = 0; c < rw; c++) if (setId[c] >= 0) used[setId[c]] = 1;
+            int nextFree = 0;
+            for (int c = 0; c < rw; c++) {
+                if (setId[c] >= 0) continue;
+                while (used[nextFree]) nextFree++;
+                setId[c] = nextFree;
+                used[nextFree] = 1;
+            }
+            for (int i = 0; i < (int)parent.size(); i++) parent[i] = i;
+
+            // 2. Room row: open rooms, randomly join neighbours in different sets
+            row.fill(true);
+            for (int c = 0; c < rw; c++) {
+                row.set(2 * c + 1, 0, false);
+                if (c + 1 == rw) break;
+                int a = findRoot(parent, setId[c]);
+                int b = findRoot(parent, setId[c + 1]);
+                if (a != b && (lastRow || (rand() & 1))) {
+                    parent[b] = a;
+                    row.set(2 * c + 2, 0, false);
+                }
+            }
+            for (int c = 0; c < rw; c++) setId[c] = findRoot(parent, setId[c]);
+            sink.writeRow(z++, row.row(0));
+
+            if (lastRow) break;
+
+            // 3. Passage row: every set carves down at least once
+            std::fill(members.begin(), members.end(), 0);
+            std::fill(carvedDown.begin(), carvedDown.end(), 0);
+            for (int c = 0; c < rw; c++) members[setId[c]]++;
+
+            row.fill(true);
+            for (int c = 0; c < rw; c++) {
+                int s = setId[c];
+                members[s]--;
+                down[c] = (rand() & 1) || (members[s] == 0 && !carvedDown[s]);
+                if (down[c]) {
+                    carvedDown[s] = 1;
+                    row.set(2 * c + 1, 0, false);
+                }
+            }
+            for (int c = 0; c < rw; c++) if (!down[c]) setId[c] = -1;
+            sink.writeRow(z++, row.row(0));
+        }
+
+        // Closing wall rows (one for odd heights)
+        for (; z < height; z++) sink.writeRow(z, wallRow.row(0));
+        sink.endMaze();
+    }
+
+private:
+    static int findRoot(std::vector<int>& parent, int a) {
+        while (parent[a] != a) {
+            parent[a] = parent[parent[a]];
+            a = parent[a];
+        }
+        return a;
+    }
+};
+
+// ============================================================================
+// GENERATOR REGISTRY
+// ============================================================================
+inline MazeGenerator* const* getGenerators(int& count) {
+    static BacktrackerGenerator backtracker;
+    static KruskalGenerator kruskal;
+    static WilsonGenerator wilson;
+    static EllerGenerator eller;
+    static MazeGenerator* const list[] = { &backtracker, &kruskal, &wilson, &eller };
+    count = (int)(sizeof(list) / sizeof(list[0]));
+    return list;
+}
+
+// Look up a generator by name; NULL if unknown
+inline MazeGenerator* findGenerator(const char* name) {
+    int count;
+    MazeGenerator* const* list = getGenerators(count);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(list[i]->name(), name) == 0) return list[i];
+    }
+    return NULL;
+}
+
+#endif // GENERATORS_H
@@ -0,0 +1,321 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Instanced Mesh Header
+ *
+ * Many copies of one shared mesh drawn with a single call:
+ * - LocalMesh: a primitive tessellated once in local space
+ *   (indexed triangles, positions + normals)
+ * - InstanceBatch: per-instance model matrices collected each frame. With
+ *   CPU lighting the mesh is expanded for every instance into one
+ *   vertex/colour stream (lit once per unique vertex) and drawn with one
+ *   glDrawElements; with the shader (shader.h) the shared mesh is drawn
+ *   once per batch by glDrawElementsInstanced from the matrices alone
+ ******************************************************************************/
+
+#ifndef INSTANCING_H
+#define INSTANCING_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/gl.h>
+
+#include "matrix.h"
+#include "lighting.h"
+#include "lightgrid.h"
+#include "draw.h"
+#include "arena.h"
+#include "fasttrig.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// LOCAL MESH
+// ============================================================================
+struct LocalMesh {
+    std::vector<Vec4> positions;
+    std::vector<Vec4> normals;          // w = 0
+    std::vector<unsigned int> indices;  // Triangles
+    Vec4 boundsMin, boundsMax;          // Box around the positions
+
+    int vertexCount() const { return (int)positions.size(); }
+    int indexCount() const { return (int)indices.size(); }
+
+    void clear() {
+        positions.clear();
+        normals.clear();
+        indices.clear();
+    }
+
+    // Box around the mesh under an affine transform (from the local box's
+    // centre and extents, no per-vertex work)
+    void worldBounds(const Affine3x4& A, Vec4& lo, Vec4& hi) const {
+        Vec4 c = A.transformPoint((boundsMin + boundsMax) * 0.5f);
+        Vec4 e = (boundsMax - boundsMin) * 0.5f;
+        float r[3];
+        for (int row = 0; row < 3; row++) {
+            r[row] = fabs(A.m[0][row]) * e.x + fabs(A.m[1][row]) * e.y + fabs(A.m[2][row]) * e.z;
+        }
+        lo = Vec4(c.x - r[0], c.y - r[1], c.z - r[2]);
+        hi = Vec4(c.x + r[0], c.y + r[1], c.z + r[2]);
+    }
+
+    int addVertex(const Vec4& p, const Vec4& n) {
+        if (positions.empty()) {
+            boundsMin = boundsMax = p;
+        } else {
+            boundsMin = Vec4(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+            boundsMax = Vec4(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+        }
+        positions.push_back(p);
+        Vec4 dir = n;
+        dir.w = 0.0f;
+        normals.push_back(dir);
+        return (int)positions.size() - 1;
+    }
+
+    void addTriangle(int a, int b, int c) {
+        indices.push_back(a);
+        indices.push_back(b);
+        indices.push_back(c);
+    }
+};
+
+// Unit cube centred at the origin: 4 vertices per face so every face has
+// its own normal. Face f owns vertices [4f, 4f + 4), same order as
+// emitUnitCubeManual.
+inline void buildCubeMesh(LocalMesh& mesh) {
+    static const Vec4 corners[8] = {
+        Vec4(-0.5f, -0.5f, 0.5f), Vec4(0.5f, -0.5f, 0.5f), Vec4(0.5f, 0.5f, 0.5f), Vec4(-0.5f, 0.5f, 0.5f),
+        Vec4(-0.5f, -0.5f, -0.5f), Vec4(0.5f, -0.5f, -0.5f), Vec4(0.5f, 0.5f, -0.5f), Vec4(-0.5f, 0.5f, -0.5f)
+    };
+    static const int faces[6][4] = {
+        {0, 1, 2, 3}, {5, 4, 7, 6}, {3, 2, 6, 7}, {4, 5, 1, 0}, {1, 5, 6, 2}, {4, 0, 3, 7}
+    };
+    static const Vec4 normals[6] = {
+        Vec4(0, 0, 1), Vec4(0, 0, -1), Vec4(0, 1, 0), Vec4(0, -1, 0), Vec4(1, 0, 0), Vec4(-1, 0, 0)
+    };
+    mesh.clear();
+    for (int f = 0; f < 6; f++) {
+        int base = mesh.vertexCount();
+        for (int k = 0; k < 4; k++) mesh.addVertex(corners[faces[f][k]], normals[f]);
+        mesh.addTriangle(base, base + 1, base + 2);
+        mesh.addTriangle(base, base + 2, base + 3);
+    }
+}
+
+// Sphere of the given radius, same parametrization as drawManualSphereManual
+inline void buildSphereMesh(LocalMesh& mesh, float radius, int slices, int stacks) {
+    mesh.clear();
+
+    for (int i = 0; i <= stacks; ++i) {
+        // phi = a - pi/2 with a = i/stacks * pi: cos(phi) = sin(a), sin(phi) = -cos(a)
+        float cosPhi, sinPhi;
+        circleSinCos(i, 2 * stacks, cosPhi, sinPhi);
+        sinPhi = -sinPhi;
+        for (int j = 0; j <= slices; ++j) {
+            float sinTheta, cosTheta;
+            circleSinCos(j, slices, sinTheta, cosTheta);
+            Vec4 n(cosPhi * cosTheta, sinPhi, cosPhi * sinTheta);
+            mesh.addVertex(n * radius, n);
+        }
+    }
+
+    int row = slices + 1;
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            int a = i * row + j;
+            int b = (i + 1) * row + j;
+            mesh.addTriangle(a, b, b + 1);
+            mesh.addTriangle(a, b + 1, a + 1);
+        }
+    }
+}
+
+// Cone with its base on y = 0, same normals as drawManualConeManual
+inline void buildConeMesh(LocalMesh& mesh, float radius, float height, int slices) {
+    mesh.clear();
+
+    // Side: tip plus a ring with slanted normals
+    int tip = mesh.addVertex(Vec4(0, height, 0), Vec4(0, 1, 0));
+    int ring = mesh.vertexCount();
+    for (int i = 0; i <= slices; i++) {
+        float sinTheta, cosTheta;
+        circleSinCos(i, slices, sinTheta, cosTheta);
+        float x = radius * cosTheta;
+        float z = radius * sinTheta;
+        Vec4 n(x / radius, radius / height, z / radius);
+        n.normalize();
+        mesh.addVertex(Vec4(x, 0, z), n);
+    }
+    for (int i = 0; i < slices; i++) {
+        mesh.addTriangle(tip, ring + i, ring + i + 1);
+    }
+
+    // Base: centre plus a ring facing down
+    Vec4 down(0, -1, 0);
+    int center = mesh.addVertex(Vec4(0, 0, 0), down);
+    int base = mesh.vertexCount();
+    for (int i = 0; i <= slices; i++) {
+        float sinTheta, cosTheta;
+        circleSinCos(-i, slices, sinTheta, cosTheta);
+        mesh.addVertex(Vec4(radius * cosTheta, 0, radius * sinTheta), down);
+    }
+    for (int i = 0; i < slices; i++) {
+        mesh.addTriangle(center, base + i, base + i + 1);
+    }
+}
+
+// Unit quad in the xz plane facing +y, centred at the origin
+inline void buildQuadMesh(LocalMesh& mesh) {
+    Vec4 up(0, 1, 0);
+    mesh.clear();
+    mesh.addVertex(Vec4(-0.5f, 0, -0.5f), up);
+    mesh.addVertex(Vec4(0.5f, 0, -0.5f), up);
+    mesh.addVertex(Vec4(0.5f, 0, 0.5f), up);
+    mesh.addVertex(Vec4(-0.5f, 0, 0.5f), up);
+    mesh.addTriangle(0, 2, 1);
+    mesh.addTriangle(0, 3, 2);
+}
+
+// Cylinder (ruled surface, CG.5 2.1) centred on the origin along y:
+// x = r*cos(u), z = r*sin(u), y = v
+inline void buildCylinderMesh(LocalMesh& mesh, float radius, float height, int slices) {
+    float halfHeight = height / 2.0f;
+    mesh.clear();
+
+    // Side: pairs of bottom/top vertices with radial normals
+    for (int i = 0; i <= slices; i++) {
+        float sinTheta, cosTheta;
+        circleSinCos(i, slices, sinTheta, cosTheta);
+        Vec4 n(cosTheta, 0, sinTheta);
+        mesh.addVertex(Vec4(radius * n.x, -halfHeight, radius * n.z), n);
+        mesh.addVertex(Vec4(radius * n.x, halfHeight, radius * n.z), n);
+    }
+    for (int i = 0; i < slices; i++) {
+        int a = 2 * i;
+        mesh.addTriangle(a, a + 1, a + 3);
+        mesh.addTriangle(a, a + 3, a + 2);
+    }
+
+    // Caps: centre plus a ring each
+    for (int cap = 0; cap < 2; cap++) {
+        float y = cap == 0 ? halfHeight : -halfHeight;
+        float dir = cap == 0 ? 1.0f : -1.0f;
+        Vec4 n(0, dir, 0);
+        int center = mesh.addVertex(Vec4(0, y, 0), n);
+        int ring = mesh.vertexCount();
+        for (int i = 0; i <= slices; i++) {
+            float sinTheta, cosTheta;
+            circleSinCos(cap == 0 ? i : -i, slices, sinTheta, cosTheta);
+            mesh.addVertex(Vec4(radius * cosTheta, y, radius * sinTheta), n);
+        }
+        for (int i = 0; i < slices; i++) {
+            mesh.addTriangle(center, ring + i, ring + i + 1);
+        }
+    }
+}
+
+// Torus (surface of revolution, CG.5 2.2) lying in the xz plane:
+// x = (R + r*cos(v)) * cos(u), z = (R + r*cos(v)) * sin(u), y = r * sin(v)
+inline void buildTorusMesh(LocalMesh& mesh, float innerRadius, float outerRadius, int nsides, int rings) {
+    float ringRadius = (outerRadius - innerRadius) / 2.0f;
+    float centerRadius = innerRadius + ringRadius;
+    mesh.clear();
+
+    for (int i = 0; i <= rings; i++) {
+        float sinTheta, cosTheta;
+        circleSinCos(i, rings, sinTheta, cosTheta);
+        for (int j = 0; j <= nsides; j++) {
+            float sinPhi, cosPhi;
+            circleSinCos(j, nsides, sinPhi, cosPhi);
+            Vec4 n(cosPhi * cosTheta, sinPhi, cosPhi * sinTheta);
+            float r = centerRadius + ringRadius * cosPhi;
+            mesh.addVertex(Vec4(r * cosTheta, ringRadius * sinPhi, r * sinTheta), n);
+        }
+    }
+
+    int row = nsides + 1;
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < nsides; j++) {
+            int a = i * row + j;
+            int b = (i + 1) * row + j;
+            mesh.addTriangle(a, b, b + 1);
+            mesh.addTriangle(a, b + 1, a + 1);
+        }
+    }
+}
+
+// ============================================================================
+// INSTANCE BATCH
+// ============================================================================
+class InstanceBatch {
+public:
+    explicit InstanceBatch(const LocalMesh* shared = NULL) : mesh(shared) {}
+
+    void setMesh(const LocalMesh* shared) { mesh = shared; }
+    const LocalMesh* sharedMesh() const { return mesh; }
+    int instanceCount() const { return transforms.size(); }
+    const Matrix4x4& transform(int i) const { return transforms[i]; }
+
+    void clear() { transforms.clear(); }
+
+    void add(const Matrix4x4& model) { transforms.push_back(model); }
+
+    // Light every instance and draw them all with one call, then clear.
+    void draw(const Vec4& viewPos, const LightSet& lights, const Material& material) {
+        if (!mesh || transforms.empty()) return;
+
+        int verts = mesh->vertexCount();
+        int count = transforms.size();
+        vertexStream.resize(verts * count * 3);
+        colorStream.resize(verts * count * 3);
+        indexStream.resize(mesh->indexCount() * count);
+
+        float* v = vertexStream.empty() ? NULL : &vertexStream[0];
+        float* c = colorStream.empty() ? NULL : &colorStream[0];
+        unsigned int* idx = &indexStream[0];
+
+        for (int k = 0; k < count; k++) {
+            Affine3x4 A(transforms[k]);
+            Affine3x4 N = A.normalMatrix();
+            Vec4 centre(A.m[3][0], A.m[3][1], A.m[3][2]);
+            for (int i = 0; i < verts; i++) {
+                Vec4 p = A.transformPoint(mesh->positions[i]);
+                Vec4 n = N.transformVector(mesh->normals[i]);
+                n.normalize();
+                Color col = calculateLighting(p, n, viewPos, lights, material, lightSamplePoint(p, centre));
+                *v++ = p.x; *v++ = p.y; *v++ = p.z;
+                *c++ = col.r; *c++ = col.g; *c++ = col.b;
+            }
+            unsigned int baseVertex = (unsigned int)(k * verts);
+            for (int i = 0; i < mesh->indexCount(); i++) {
+                *idx++ = mesh->indices[i] + baseVertex;
+            }
+        }
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, &vertexStream[0]);
+        glColorPointer(3, GL_FLOAT, 0, &colorStream[0]);
+        glDrawElements(GL_TRIANGLES, (GLsizei)indexStream.size(), GL_UNSIGNED_INT, &indexStream[0]);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        countVertices(verts * count);
+
+        clear();
+    }
+
+private:
+    const LocalMesh* mesh;
+    ArenaList<Matrix4x4> transforms;        // Frame arena
+
+    // Reused between frames
+    std::vector<float> vertexStream;
+    std::vector<float> colorStream;
+    std::vector<unsigned int> indexStream;
+};
+
+#endif // INSTANCING_H
@@ -0,0 +1,259 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Light Grid Header
+ *
+ * Many static point lights (torches) without per-vertex cost growing with
+ * the light count:
+ * - Each light is binned into every maze cell its range reaches (range =
+ *   distance where attenuation falls to LIGHT_CUTOFF)
+ * - A cell keeps at most LIGHTS_PER_CELL lights, the closest ones, so a
+ *   lit point never evaluates more than that
+ * - Cell lists are stored flat (offsets + indices) and rebuilt only when
+ *   the lights or the maze change
+ * - LightSet pairs the moving player light (and its ShadowMask) with the
+ *   grid; it converts from a single Light, so one-light callers are
+ *   unchanged
+ * - An object inside one cell shares that cell's lights (ObjectLights), so
+ *   they can be looked up once and lit in the object's frame
+ ******************************************************************************/
+
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+#include "matrix.h"
+#include "lighting.h"
+#include "shadowcast.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+const int LIGHTS_PER_CELL = 8;
+const float LIGHT_CUTOFF = 1.0f / 64.0f;
+
+class LightGrid {
+public:
+    LightGrid() : width(0), height(0), cellSize(1.0f) {}
+
+    int lightCount() const { return (int)lights.size(); }
+    bool empty() const { return lights.empty(); }
+    const Light& light(int i) const { return lights[i]; }
+
+    // Bin lights into a width x height grid of cells starting at origin (xz)
+    void build(const std::vector<Light>& source, int gridWidth, int gridHeight,
+               float size, const Vec4& gridOrigin) {
+        lights = source;
+        width = gridWidth;
+        height = gridHeight;
+        cellSize = size;
+        origin = gridOrigin;
+
+        // Every (cell, light) overlap with the light's distance to the cell
+        std::vector<Candidate> candidates;
+        for (int i = 0; i < (int)lights.size(); i++) {
+            const Light& l = lights[i];
+            if (!l.isEnabled) continue;
+            float r = l.range(LIGHT_CUTOFF);
+            int x0 = std::max(0, cellX(l.position.x - r));
+            int x1 = std::min(width - 1, cellX(l.position.x + r));
+            int z0 = std::max(0, cellZ(l.position.z - r));
+            int z1 = std::min(height - 1, cellZ(l.position.z + r));
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++) {
+                    float d = distanceToCell(l.position, x, z);
+                    if (d > r) continue;
+                    Candidate c;
+                    c.cell = z * width + x;
+                    c.distance = d;
+                    c.light = i;
+                    candidates.push_back(c);
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        // Flat lists, closest LIGHTS_PER_CELL per cell
+        cellStart.assign(width * height + 1, 0);
+        indices.clear();
+        size_t k = 0;
+        for (int cell = 0; cell < width * height; cell++) {
+            cellStart[cell] = (int)indices.size();
+            int kept = 0;
+            for (; k < candidates.size() && candidates[k].cell == cell; k++) {
+                if (kept < LIGHTS_PER_CELL) {
+                    indices.push_back((unsigned short)candidates[k].light);
+                    kept++;
+                }
+            }
+        }
+        cellStart[width * height] = (int)indices.size();
+    }
+
+    // Lights reaching the cell under a world position; count = 0 outside
+    const unsigned short* lightsAt(const Vec4& p, int& count) const {
+        int x = cellX(p.x), z = cellZ(p.z);
+        if (x < 0 || z < 0 || x >= width || z >= height) {
+            count = 0;
+            return NULL;
+        }
+        int cell = z * width + x;
+        count = cellStart[cell + 1] - cellStart[cell];
+        return count ? &indices[cellStart[cell]] : NULL;
+    }
+
+    // Cell id under a world position, -1 outside
+    int cellAt(const Vec4& p) const {
+        int x = cellX(p.x), z = cellZ(p.z);
+        if (x < 0 || z < 0 || x >= width || z >= height) return -1;
+        return z * width + x;
+    }
+
+private:
+    struct Candidate {
+        int cell;
+        float distance;
+        int light;
+        bool operator<(const Candidate& o) const {
+            return cell != o.cell ? cell < o.cell : distance < o.distance;
+        }
+    };
+
+    std::vector<Light> lights;
+    std::vector<int> cellStart;             // width*height + 1 offsets
+    std::vector<unsigned short> indices;    // Light ids, cell after cell
+    int width, height;
+    float cellSize;
+    Vec4 origin;
+
+    int cellX(float x) const { return (int)std::floor((x - origin.x) / cellSize); }
+    int cellZ(float z) const { return (int)std::floor((z - origin.z) / cellSize); }
+
+    // Horizontal distance from p to the cell's square (0 inside)
+    float distanceToCell(const Vec4& p, int x, int z) const {
+        float minX = origin.x + x * cellSize, minZ = origin.z + z * cellSize;
+        float dx = std::max(0.0f, std::max(minX - p.x, p.x - (minX + cellSize)));
+        float dz = std::max(0.0f, std::max(minZ - p.z, p.z - (minZ + cellSize)));
+        return std::sqrt(dx * dx + dz * dz);
+    }
+};
+
+// Point a vertex is binned by: stepped slightly (xz) towards the centre of
+// the object it belongs to, so a floor corner on a cell border takes the
+// shadow and torch list of its own cell, not of the neighbour it touches
+const float LIGHT_SAMPLE_NUDGE = 0.01f;
+
+inline Vec4 lightSamplePoint(const Vec4& p, const Vec4& centre) {
+    Vec4 s = p;
+    if (centre.x > p.x) s.x += LIGHT_SAMPLE_NUDGE; else if (centre.x < p.x) s.x -= LIGHT_SAMPLE_NUDGE;
+    if (centre.z > p.z) s.z += LIGHT_SAMPLE_NUDGE; else if (centre.z < p.z) s.z -= LIGHT_SAMPLE_NUDGE;
+    return s;
+}
+
+// Torch as the game places them (flame at position): warm, short range,
+// no ambient of its own
+inline Light torchLight(const Vec4& position) {
+    Light torch;
+    torch.position = position;
+    torch.ambient = Color(0.0f, 0.0f, 0.0f);
+    torch.diffuse = Color(1.0f, 0.6f, 0.25f);
+    torch.specular = Color(0.6f, 0.4f, 0.2f);
+    torch.constantAtt = 1.0f;
+    torch.linearAtt = 0.5f;
+    torch.quadraticAtt = 1.5f;
+    return torch;
+}
+
+// ============================================================================
+// OBJECT LIGHTS - the lights every point of one object shares
+// Copies, so the caller may move them into the object's frame.
+// ============================================================================
+struct ObjectLights {
+    Light primary;
+    bool primaryLit;                    // False: primary ambient only (shadowed)
+    Light local[LIGHTS_PER_CELL];       // Grid lights of the object's cell
+    int count;
+
+    ObjectLights() : primaryLit(true), count(0) {}
+};
+
+inline Color calculateLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos,
+                               const ObjectLights& lights, const Material& material) {
+    Color c = lights.primaryLit ? calculateLighting(position, normal, viewPos, lights.primary, material)
+                                : lights.primary.ambient * material.ambient;
+    for (int i = 0; i < lights.count; i++) {
+        c = c + directLighting(position, normal, viewPos, lights.local[i], material);
+    }
+    return c;
+}
+
+// ============================================================================
+// LIGHT SET - the primary light plus the grid lights around a point
+// ============================================================================
+struct LightSet {
+    const Light* primary;
+    const LightGrid* grid;      // NULL or empty = primary only
+    const ShadowMask* shadow;   // Cells the primary light reaches; NULL = all
+
+    LightSet() : primary(NULL), grid(NULL), shadow(NULL) {}
+    LightSet(const Light& light) : primary(&light), grid(NULL), shadow(NULL) {}
+    LightSet(const Light& light, const LightGrid* lights, const ShadowMask* mask)
+        : primary(&light), grid(lights && !lights->empty() ? lights : NULL), shadow(mask) {}
+
+    // Only the primary light, unshadowed (object-space lighting is exact)
+    bool single() const { return grid == NULL && shadow == NULL; }
+
+    // Lights of the box [lo, hi] around an object centred at centre. True
+    // when its sample points (see lightSamplePoint) all fall in one cell:
+    // one shadow test and one torch list then hold for every vertex of a
+    // convex object inside it. False when it straddles a border.
+    bool lightsForBox(const Vec4& lo, const Vec4& hi, const Vec4& centre, ObjectLights& out) const {
+        out.primary = *primary;
+        out.primaryLit = true;
+        out.count = 0;
+        if (single()) return true;
+
+        Vec4 a = lightSamplePoint(lo, centre), b = lightSamplePoint(hi, centre);
+        if (shadow) {
+            int cell = shadow->cellAt(a);
+            if (cell < 0 || cell != shadow->cellAt(b)) return false;
+            out.primaryLit = !primary->isEnabled || shadow->isLitAt(a);
+        }
+        if (grid) {
+            int cell = grid->cellAt(a);
+            if (cell < 0 || cell != grid->cellAt(b)) return false;
+            const unsigned short* ids = grid->lightsAt(a, out.count);
+            for (int i = 0; i < out.count; i++) out.local[i] = grid->light(ids[i]);
+        }
+        return true;
+    }
+};
+
+// Primary light as before (ambient only where it is shadowed), plus the
+// direct (non-ambient) light of each grid light binned into the cell under
+// sample (see lightSamplePoint)
+inline Color calculateLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos,
+                               const LightSet& lights, const Material& material, const Vec4& sample) {
+    const Light& primary = *lights.primary;
+    Color c;
+    if (lights.shadow && primary.isEnabled && !lights.shadow->isLitAt(sample, normal)) {
+        c = primary.ambient * material.ambient;
+    } else {
+        c = calculateLighting(position, normal, viewPos, primary, material);
+    }
+    if (!lights.grid) return c;
+
+    int count;
+    const unsigned short* ids = lights.grid->lightsAt(sample, count);
+    for (int i = 0; i < count; i++) {
+        c = c + directLighting(position, normal, viewPos, lights.grid->light(ids[i]), material);
+    }
+    return c;
+}
+
+// Cell lookups at the vertex itself (wall faces are still stepped against
+// their normal for the shadow test)
+inline Color calculateLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos,
+                               const LightSet& lights, const Material& material) {
+    return calculateLighting(position, normal, viewPos, lights, material, position);
+}
+
+#endif // LIGHTGRID_H
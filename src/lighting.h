@@ -12,6 +12,7 @@
 #define LIGHTING_H
 
 #include "matrix.h"
+#include "framestats.h"
 #include <algorithm>
 
 // Light color structure
@@ -73,6 +74,18 @@ public:
     float getAttenuation(float distance) const {
         return 1.0f / (constantAtt + linearAtt * distance + quadraticAtt * distance * distance);
     }
+    
+    // Distance at which attenuation falls to cutoff (beyond it the light
+    // is treated as having no effect)
+    float range(float cutoff) const {
+        float k = constantAtt - 1.0f / cutoff;
+        if (k >= 0) return 0;
+        if (quadraticAtt > 0) {
+            return (-linearAtt + std::sqrt(linearAtt * linearAtt - 4.0f * quadraticAtt * k)) /
+                   (2.0f * quadraticAtt);
+        }
+        return linearAtt > 0 ? -k / linearAtt : 1e9f;
+    }
 };
 
 // ============================================================================
@@ -107,13 +120,10 @@ public:
 // MANUAL LIGHTING CALCULATIONS
 // ============================================================================
 
-// Calculate lighting for a single point using Lambert and Phong models
-inline Color calculateLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos, 
-                             const Light& light, const Material& material) {
-    if (!light.isEnabled) return Color(0,0,0);
-
-    // Ambient
-    Color ambient = light.ambient * material.ambient;
+// Attenuated diffuse + specular of one light at a point (no ambient)
+inline Color directLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos,
+                            const Light& light, const Material& material) {
+    frameCounters().lightingEvals++;
 
     // Light direction
     Vec4 lightDir = light.position - position;
@@ -146,7 +156,18 @@ inline Color calculateLighting(const Vec4& position, const Vec4& normal, const V
     // Attenuation
     float attenuation = light.getAttenuation(distance);
 
-    return ambient + (diffuse + specular) * attenuation;
+    return (diffuse + specular) * attenuation;
+}
+
+// Calculate lighting for a single point using Lambert and Phong models
+inline Color calculateLighting(const Vec4& position, const Vec4& normal, const Vec4& viewPos, 
+                             const Light& light, const Material& material) {
+    if (!light.isEnabled) return Color(0,0,0);
+
+    // Ambient
+    Color ambient = light.ambient * material.ambient;
+
+    return ambient + directLighting(position, normal, viewPos, light, material);
 }
 
 // Check if a face is visible (Back-face culling)
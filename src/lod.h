@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Level of Detail Header
+ *
+ * Tessellation level selection by projected size:
+ * - Each procedural primitive has LOD_LEVELS precomputed tessellations,
+ *   level 0 being the original full-detail one
+ * - An object's bounding sphere is projected to an on-screen size in
+ *   pixels and mapped to a level through LOD_PIXELS thresholds
+ * - LodSelector adds hysteresis so objects near a threshold do not pop
+ *   back and forth between levels
+ ******************************************************************************/
+
+#ifndef LOD_H
+#define LOD_H
+
+#include "config.h"
+#include "matrix.h"
+
+#include <cmath>
+
+const int LOD_LEVELS = 4;
+
+// Projected diameter (pixels) below which each level hands over to the next
+const float LOD_PIXELS[LOD_LEVELS - 1] = {120.0f, 40.0f, 12.0f};
+
+// Fraction a size must move past a threshold before the level changes
+const float LOD_HYSTERESIS = 0.15f;
+
+// Tessellations per level
+const int SPHERE_LOD_SLICES[LOD_LEVELS] = {15, 10, 6, 4};
+const int SPHERE_LOD_STACKS[LOD_LEVELS] = {15, 8, 5, 3};
+const int CONE_LOD_SLICES[LOD_LEVELS] = {10, 6, 4, 3};
+const int CYLINDER_LOD_SLICES[LOD_LEVELS] = {12, 8, 6, 4};
+const int TORUS_LOD_SIDES[LOD_LEVELS] = {10, 6, 4, 3};
+const int TORUS_LOD_RINGS[LOD_LEVELS] = {20, 12, 8, 6};
+
+// ============================================================================
+// LOD VIEW - projection of bounding spheres to pixels for one frame
+// ============================================================================
+struct LodView {
+    Vec4 eye;
+    float pixelsPerUnit;    // Pixels covered by 1 unit at distance 1
+
+    LodView() : pixelsPerUnit(1.0f) {}
+
+    LodView(const Vec4& eyePos, float fovY, int viewportHeight) : eye(eyePos) {
+        float halfFov = fovY * 0.5f * (float)M_PI / 180.0f;
+        pixelsPerUnit = viewportHeight * 0.5f / tanf(halfFov);
+    }
+
+    // On-screen diameter of a sphere, in pixels
+    float projectedSize(const Vec4& center, float radius) const {
+        Vec4 d = center - eye;
+        float dist = d.length();
+        if (dist <= radius) return 1e9f;   // Camera inside the bounds
+        return 2.0f * radius * pixelsPerUnit / dist;
+    }
+};
+
+// Level for a size, without hysteresis
+inline int lodForSize(float pixels) {
+    int level = 0;
+    while (level < LOD_LEVELS - 1 && pixels < LOD_PIXELS[level]) level++;
+    return level;
+}
+
+// ============================================================================
+// LOD SELECTOR - per-object level with hysteresis
+// ============================================================================
+class LodSelector {
+public:
+    LodSelector() : current(0) {}
+
+    int level() const { return current; }
+
+    int select(float pixels) {
+        int target = lodForSize(pixels);
+
+        // Coarser only once clearly below the threshold, finer once clearly above
+        while (target > current && pixels < LOD_PIXELS[current] * (1.0f - LOD_HYSTERESIS)) {
+            current++;
+        }
+        while (target < current && pixels > LOD_PIXELS[current - 1] * (1.0f + LOD_HYSTERESIS)) {
+            current--;
+        }
+        return current;
+    }
+
+private:
+    int current;
+};
+
+#endif // LOD_H
@@ -20,9 +20,13 @@
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
+#include <GL/freeglut_ext.h>
 
 #include "game.h"
 
+#include <cstring>
+#include <cstdlib>
+
 // ============================================================================
 // GLOBAL GAME INSTANCE
 // ============================================================================
@@ -40,26 +44,37 @@ void reshape(int w, int h) {
     game.handleResize(w, h);
 }
 
+// While a replay runs, live input is ignored (except ESC to quit)
 void keyboard(unsigned char key, int x, int y) {
+    if (game.replayer.isActive() && key != 27) return;
     game.handleKeyDown(key);
 }
 
 void keyboardUp(unsigned char key, int x, int y) {
+    if (game.replayer.isActive()) return;
     game.handleKeyUp(key);
 }
 
 void mouseMotion(int x, int y) {
+    if (game.replayer.isActive()) return;
+    
     if (game.state == STATE_PLAYING) {
         game.handleMouseMove(x, y);
         
         // Warp mouse back to center when it gets too close to edge
         if (game.input.needsWarp(game.windowWidth, game.windowHeight)) {
-            game.input.prepareForWarp();
+            game.handleMouseWarp();
             glutWarpPointer(game.input.windowCenterX, game.input.windowCenterY);
         }
     }
 }
 
+// Window closed by the window manager: flush the recording and stats
+// before GLUT exits
+void closeWindow() {
+    game.shutdown();
+}
+
 void update(int value) {
     float currentTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
     game.update(currentTime);
@@ -74,7 +89,7 @@ void update(int value) {
 
 void initOpenGL() {
     // Clear color
-    glClearColor(0.05f, 0.05f, 0.1f, 1.0f);
+    glClearColor(Config::SKY_COLOR[0], Config::SKY_COLOR[1], Config::SKY_COLOR[2], 1.0f);
     
     // Enable depth testing (Z-buffer)
     glEnable(GL_DEPTH_TEST);
@@ -102,10 +117,10 @@ void initOpenGL() {
 
     // Enable Fog (CG.6)
     glEnable(GL_FOG);
-    GLfloat fogColor[] = {0.05f, 0.05f, 0.1f, 1.0f}; // Match clear color
+    GLfloat fogColor[] = {Config::SKY_COLOR[0], Config::SKY_COLOR[1], Config::SKY_COLOR[2], 1.0f}; // Match clear color
     glFogfv(GL_FOG_COLOR, fogColor);
     glFogi(GL_FOG_MODE, GL_EXP);
-    glFogf(GL_FOG_DENSITY, 0.05f);
+    glFogf(GL_FOG_DENSITY, Config::FOG_DENSITY);
     glHint(GL_FOG_HINT, GL_DONT_CARE);
 }
 
@@ -114,8 +129,49 @@ void initOpenGL() {
 // ============================================================================
 
 int main(int argc, char** argv) {
-    // Initialize GLUT
+    // Initialize GLUT (removes the options it understands from argv)
     glutInit(&argc, argv);
+    
+    // Game options
+    const char* savePath = NULL;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--generator") == 0 && i + 1 < argc) {
+            MazeGenerator* gen = findGenerator(argv[++i]);
+            if (gen) {
+                game.generator = gen;
+            } else {
+                printf("Unknown generator '%s', using %s\n", argv[i], game.generator->name());
+            }
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            game.mazeFilePath = argv[++i];
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            game.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--stats-csv") == 0 && i + 1 < argc) {
+            game.statsCsvPath = argv[++i];
+        } else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc) {
+            RenderBackend* backend = game.backends.find(argv[++i]);
+            if (backend) {
+                game.backend = backend;
+            } else {
+                printf("Unknown renderer '%s', using %s\n", argv[i], game.backend->name());
+            }
+        } else if (strcmp(argv[i], "--assert-no-alloc") == 0) {
+            game.allocGuard.enabled = true;
+            if (!allocationsTracked()) printf("Built without TRACK_ALLOCATIONS, --assert-no-alloc does nothing\n");
+        }
+    }
+    
+    // A replay brings its own seed; recording stores ours
+    if (replayPath && !game.startReplay(replayPath)) return 1;
+    if (recordPath && !replayPath && !game.startRecording(recordPath)) return 1;
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(Config::WINDOW_WIDTH, Config::WINDOW_HEIGHT);
     glutInitWindowPosition(100, 100);
@@ -127,6 +183,7 @@ int main(int argc, char** argv) {
     // Initialize game
     game.init();
     game.printWelcome();
+    if (savePath) game.saveMaze(savePath);
     
     // Register callbacks
     glutDisplayFunc(display);
@@ -134,6 +191,7 @@ int main(int argc, char** argv) {
     glutKeyboardFunc(keyboard);
     glutKeyboardUpFunc(keyboardUp);
     glutPassiveMotionFunc(mouseMotion);
+    glutCloseFunc(closeWindow);
     
     // Hide cursor
     glutSetCursor(GLUT_CURSOR_NONE);
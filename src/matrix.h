@@ -98,6 +98,138 @@ struct Matrix4x4 {
     }
 };
 
+// ============================================================================
+// AFFINE 3x4 MATRIX
+// Model and view matrices never project, so their last row is always
+// (0 0 0 1). Affine3x4 drops that row: compose is 36 multiplies instead
+// of 64, and points transform without the homogeneous divide.
+// Same m[col][row] layout as Matrix4x4; column 3 is the translation.
+// ============================================================================
+struct Affine3x4 {
+    float m[4][3];
+    
+    Affine3x4() {
+        setIdentity();
+    }
+    
+    // Drops the projective row (which must be 0 0 0 1)
+    explicit Affine3x4(const Matrix4x4& M) {
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 3; row++) {
+                m[col][row] = M.m[col][row];
+            }
+        }
+    }
+    
+    void setIdentity() {
+        memset(m, 0, sizeof(m));
+        m[0][0] = m[1][1] = m[2][2] = 1.0f;
+    }
+    
+    Matrix4x4 toMatrix4x4() const {
+        Matrix4x4 M;
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 3; row++) {
+                M.m[col][row] = m[col][row];
+            }
+        }
+        return M;
+    }
+    
+    // Result = This * Other
+    Affine3x4 operator*(const Affine3x4& other) const {
+        Affine3x4 result;
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 3; row++) {
+                float sum = m[0][row] * other.m[col][0] +
+                            m[1][row] * other.m[col][1] +
+                            m[2][row] * other.m[col][2];
+                result.m[col][row] = (col == 3) ? sum + m[3][row] : sum;
+            }
+        }
+        return result;
+    }
+    
+    // p' = L * p + t (w is ignored)
+    Vec4 transformPoint(const Vec4& p) const {
+        return Vec4(
+            m[0][0]*p.x + m[1][0]*p.y + m[2][0]*p.z + m[3][0],
+            m[0][1]*p.x + m[1][1]*p.y + m[2][1]*p.z + m[3][1],
+            m[0][2]*p.x + m[1][2]*p.y + m[2][2]*p.z + m[3][2]
+        );
+    }
+    
+    // v' = L * v (directions: no translation, result has w = 0)
+    Vec4 transformVector(const Vec4& v) const {
+        return Vec4(
+            m[0][0]*v.x + m[1][0]*v.y + m[2][0]*v.z,
+            m[0][1]*v.x + m[1][1]*v.y + m[2][1]*v.z,
+            m[0][2]*v.x + m[1][2]*v.y + m[2][2]*v.z,
+            0.0f
+        );
+    }
+    
+    float determinant3x3() const {
+        return m[0][0] * (m[1][1]*m[2][2] - m[2][1]*m[1][2])
+             - m[1][0] * (m[0][1]*m[2][2] - m[2][1]*m[0][2])
+             + m[2][0] * (m[0][1]*m[1][2] - m[1][1]*m[0][2]);
+    }
+    
+    // General inverse: L^-1 by cofactors, t' = -L^-1 * t.
+    // A singular matrix returns identity.
+    Affine3x4 inverse() const {
+        Affine3x4 inv;
+        float det = determinant3x3();
+        if (fabs(det) < 1e-12f) return inv;
+        float invDet = 1.0f / det;
+        
+        inv.m[0][0] =  (m[1][1]*m[2][2] - m[2][1]*m[1][2]) * invDet;
+        inv.m[1][0] = -(m[1][0]*m[2][2] - m[2][0]*m[1][2]) * invDet;
+        inv.m[2][0] =  (m[1][0]*m[2][1] - m[2][0]*m[1][1]) * invDet;
+        inv.m[0][1] = -(m[0][1]*m[2][2] - m[2][1]*m[0][2]) * invDet;
+        inv.m[1][1] =  (m[0][0]*m[2][2] - m[2][0]*m[0][2]) * invDet;
+        inv.m[2][1] = -(m[0][0]*m[2][1] - m[2][0]*m[0][1]) * invDet;
+        inv.m[0][2] =  (m[0][1]*m[1][2] - m[1][1]*m[0][2]) * invDet;
+        inv.m[1][2] = -(m[0][0]*m[1][2] - m[1][0]*m[0][2]) * invDet;
+        inv.m[2][2] =  (m[0][0]*m[1][1] - m[1][0]*m[0][1]) * invDet;
+        
+        Vec4 t = inv.transformVector(Vec4(m[3][0], m[3][1], m[3][2]));
+        inv.m[3][0] = -t.x;
+        inv.m[3][1] = -t.y;
+        inv.m[3][2] = -t.z;
+        return inv;
+    }
+    
+    // Inverse of a rotation + translation (e.g. the view matrix):
+    // L^-1 = L^T, t' = -L^T * t
+    Affine3x4 rigidInverse() const {
+        Affine3x4 inv;
+        for (int col = 0; col < 3; col++) {
+            for (int row = 0; row < 3; row++) {
+                inv.m[col][row] = m[row][col];
+            }
+        }
+        Vec4 t = inv.transformVector(Vec4(m[3][0], m[3][1], m[3][2]));
+        inv.m[3][0] = -t.x;
+        inv.m[3][1] = -t.y;
+        inv.m[3][2] = -t.z;
+        return inv;
+    }
+    
+    // Normal matrix (L^-1)^T with zero translation. Keeps normals
+    // perpendicular to surfaces under non-uniform scale; renormalize after.
+    Affine3x4 normalMatrix() const {
+        Affine3x4 inv = inverse();
+        Affine3x4 n;
+        for (int col = 0; col < 3; col++) {
+            for (int row = 0; row < 3; row++) {
+                n.m[col][row] = inv.m[row][col];
+            }
+        }
+        return n;
+    }
+};
+
 // ============================================================================
 // TRANSLATION MATRIX
 // | 1  0  0  tx |
@@ -235,10 +367,11 @@ inline Matrix4x4 createRotationAxisMatrix(float angle, float uX, float uY, float
 }
 
 // ============================================================================
-// VIEW MATRIX (Replaces gluLookAt)
-// Constructs a view matrix from eye position, target, and up vector
+// CAMERA TRANSFORM
+// Camera-to-world: columns are the camera's right, up and back axes, then
+// the eye position. Rotation + translation only.
 // ============================================================================
-inline Matrix4x4 createLookAtMatrix(const Vec4& eye, const Vec4& center, const Vec4& up) {
+inline Affine3x4 createCameraTransform(const Vec4& eye, const Vec4& center, const Vec4& up) {
     Vec4 f = center - eye;
     f.normalize();
     
@@ -250,32 +383,20 @@ inline Matrix4x4 createLookAtMatrix(const Vec4& eye, const Vec4& center, const V
     
     u = s.cross(f);
     
-    Matrix4x4 mat;
-    
-    // Rotation part (transposed basis)
-    // Col 0
-    mat.m[0][0] = s.x;
-    mat.m[0][1] = u.x;
-    mat.m[0][2] = -f.x;
-    
-    // Col 1
-    mat.m[1][0] = s.y;
-    mat.m[1][1] = u.y;
-    mat.m[1][2] = -f.y;
-    
-    // Col 2
-    mat.m[2][0] = s.z;
-    mat.m[2][1] = u.z;
-    mat.m[2][2] = -f.z;
-    
-    // Translation part (Col 3)
-    // -dot(s, eye), -dot(u, eye), dot(f, eye)
-    mat.m[3][0] = -s.dot(eye);
-    mat.m[3][1] = -u.dot(eye);
-    mat.m[3][2] = f.dot(eye);
-    mat.m[3][3] = 1.0f;
-    
-    return mat;
+    Affine3x4 cam;
+    cam.m[0][0] = s.x;  cam.m[0][1] = s.y;  cam.m[0][2] = s.z;
+    cam.m[1][0] = u.x;  cam.m[1][1] = u.y;  cam.m[1][2] = u.z;
+    cam.m[2][0] = -f.x; cam.m[2][1] = -f.y; cam.m[2][2] = -f.z;
+    cam.m[3][0] = eye.x; cam.m[3][1] = eye.y; cam.m[3][2] = eye.z;
+    return cam;
+}
+
+// ============================================================================
+// VIEW MATRIX (Replaces gluLookAt)
+// World-to-camera: the rigid inverse of the camera transform
+// ============================================================================
+inline Matrix4x4 createLookAtMatrix(const Vec4& eye, const Vec4& center, const Vec4& up) {
+    return createCameraTransform(eye, center, up).rigidInverse().toMatrix4x4();
 }
 
 // ============================================================================
@@ -6,15 +6,28 @@
  * - Static walls (3D boxes)
  * - Exit gate
  * - Collision detection
+ * - Bit-packed wall occupancy (see bitgrid.h)
+ * - Indexed empty cells for spawning (see cellindex.h)
+ * - Runtime re-carving of room blocks (shifting walls) with dirty tracking
+ * - Union-find connectivity with minimal repair carving
+ * - Pluggable generators (see generators.h)
+ * - Binary .smaz save / zero-copy load (see mazefile.h)
  ******************************************************************************/
 
 #ifndef MAZE_H
 #define MAZE_H
 
 #include "matrix.h"
+#include "bitgrid.h"
+#include "cellindex.h"
+#include "disjointset.h"
+#include "generators.h"
+#include "mazefile.h"
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
+#include <cstdio>
 
 // Cell types
 enum CellType {
@@ -24,6 +37,42 @@ enum CellType {
     CELL_EXIT = 6
 };
 
+// ============================================================================
+// DIRTY RECT - Bounding box of cells changed since the last consume
+// ============================================================================
+struct DirtyRect {
+    int x0, z0, x1, z1;
+    bool empty;
+    
+    DirtyRect() { clear(); }
+    
+    void clear() {
+        x0 = z0 = x1 = z1 = 0;
+        empty = true;
+    }
+    
+    void add(int x, int z) {
+        if (empty) {
+            x0 = x1 = x;
+            z0 = z1 = z;
+            empty = false;
+            return;
+        }
+        x0 = std::min(x0, x); x1 = std::max(x1, x);
+        z0 = std::min(z0, z); z1 = std::max(z1, z);
+    }
+    
+    bool contains(int x, int z) const {
+        return touches(x, z, 0);
+    }
+    
+    // True if (x, z) is inside the box grown by margin cells
+    bool touches(int x, int z, int margin) const {
+        return !empty && x >= x0 - margin && x <= x1 + margin &&
+               z >= z0 - margin && z <= z1 + margin;
+    }
+};
+
 // ============================================================================
 // MAZE CLASS
 // ============================================================================
@@ -31,95 +80,348 @@ class Maze {
 public:
     static const int SIZE = Config::MAZE_SIZE;     // max_size max_size grid
     int grid[SIZE][SIZE];           // Cell types
+    BitGrid walls;                  // Wall bits, kept in sync with grid
+    EmptyCellIndex emptyCells;      // CELL_EMPTY cells, bucketed by distance from start
     
     float cellSize;                 // Size of each cell in world units
     Vec4 offset;                    // Maze offset in world
     
     int startX, startZ;             // Player start position
     int exitX, exitZ;               // Exit position
+    int keyX, keyZ;                 // Preset key cell from a file (-1 = random)
+    
+    DirtyRect dirty;                // Cells changed since last takeDirty()
+    unsigned int revision;          // Bumped on every cell change
+    
+    // Open-cell connectivity. Opening a cell is a union; closing one cannot
+    // be undone in a disjoint set, so it marks the sets stale and the next
+    // query rebuilds them once (O(n α(n))).
+    mutable DisjointSet regions;
+    mutable bool regionsStale;
     
     Maze() {
         cellSize = Config::CELL_SIZE;
         offset = Vec4(-SIZE * cellSize / 2, 0, -SIZE * cellSize / 2);
         startX = 1; startZ = 1;
         exitX = SIZE - 2; exitZ = SIZE - 2;
+        keyX = keyZ = -1;
+        walls.resize(SIZE, SIZE);
+        revision = 0;
+        regions.reset(SIZE * SIZE);
+        regionsStale = false;
     }
     
     // ========================================================================
     // GENERATE MAZE
     // ========================================================================
     void generate() {
-        srand((unsigned int)time(NULL));
+        BacktrackerGenerator backtracker;
+        generate(backtracker, (unsigned int)time(NULL));
+    }
+    
+    // Same generator + seed always gives the same maze
+    void generate(MazeGenerator& generator, unsigned int seed) {
+        srand(seed);
+        
+        // Stop using a mapped file's grid
+        if (walls.isBorrowed()) walls.resize(SIZE, SIZE);
+        
+        startX = 1; startZ = 1;
+        exitX = SIZE - 2; exitZ = SIZE - 2;
+        keyX = keyZ = -1;
+        
+        // Carve paths into the wall bits (uniting cells as they open), then
+        // mirror them into grid
+        regions.reset(SIZE * SIZE);
+        generator.trackRegions(&regions);
+        generator.generate(walls);
+        generator.trackRegions(NULL);
+        finishLoad(true);
+    }
+    
+    // Use a mapped .smaz file's grid in place. The maze must be SIZE x SIZE
+    // (grid is a fixed array); larger files are only usable as a BitGrid.
+    // Start, exit and key were range-checked when the file was opened.
+    bool attachFile(MappedMazeFile& file) {
+        const MazeFileHeader& h = file.header();
+        if (h.width != (uint32_t)SIZE || h.height != (uint32_t)SIZE) {
+            printf("Maze file is %ux%u, this build uses %dx%d\n", h.width, h.height, SIZE, SIZE);
+            return false;
+        }
         
-        // Initialize with walls
+        walls.attach(file.gridWords(), SIZE, SIZE);
+        startX = h.startX; startZ = h.startZ;
+        exitX = h.exitX; exitZ = h.exitZ;
+        keyX = h.keyX; keyZ = h.keyZ;
+        finishLoad(false);
+        return true;
+    }
+    
+    bool saveToFile(const char* path, int savedKeyX, int savedKeyZ) const {
+        MazeFilePositions pos;
+        pos.startX = startX; pos.startZ = startZ;
+        pos.exitX = exitX; pos.exitZ = exitZ;
+        pos.keyX = savedKeyX; pos.keyZ = savedKeyZ;
+        return writeMazeFile(path, walls, pos, true);
+    }
+    
+    // Derive grid, connectivity and spawn index from the wall bits.
+    // regionsBuilt: the generator already united the carved cells.
+    void finishLoad(bool regionsBuilt) {
         for (int x = 0; x < SIZE; x++) {
             for (int z = 0; z < SIZE; z++) {
-                grid[x][z] = CELL_WALL;
+                grid[x][z] = walls.isWall(x, z) ? CELL_WALL : CELL_EMPTY;
             }
         }
         
-        // Generate paths using simple maze algorithm
-        generatePaths(1, 1);
-        
-        // Set start and exit
+        // Set start and exit (only touch the bits if they change, so a
+        // mapped grid is not copied needlessly)
         grid[startX][startZ] = CELL_START;
         grid[exitX][exitZ] = CELL_EXIT;
+        if (walls.isWall(startX, startZ)) walls.set(startX, startZ, false);
+        if (walls.isWall(exitX, exitZ)) walls.set(exitX, exitZ, false);
+        
+        if (regionsBuilt) {
+            joinOpenNeighbours(startX, startZ);
+            joinOpenNeighbours(exitX, exitZ);
+            regionsStale = false;
+        } else {
+            rebuildRegions();
+        }
+        buildEmptyCellIndex();
         
         // Ensure path to exit exists
         ensurePathToExit();
+        
+        // Everything changed
+        dirty.clear();
+        dirty.add(0, 0);
+        dirty.add(SIZE - 1, SIZE - 1);
+        revision++;
     }
     
-    // Simple recursive backtracking maze generation
-    void generatePaths(int x, int z) {
-        grid[x][z] = CELL_EMPTY;
-        
-        // Directions: up, right, down, left
-        int dirs[4][2] = {{0, -2}, {2, 0}, {0, 2}, {-2, 0}};
-        
-        // Shuffle directions
-        for (int i = 3; i > 0; i--) {
-            int j = rand() % (i + 1);
-            std::swap(dirs[i][0], dirs[j][0]);
-            std::swap(dirs[i][1], dirs[j][1]);
+    // Rebuild the wall bits from grid (after bulk writes to grid)
+    void syncWallBits() {
+        for (int z = 0; z < SIZE; z++) {
+            for (int x = 0; x < SIZE; x++) {
+                walls.set(x, z, grid[x][z] == CELL_WALL);
+            }
         }
+    }
+    
+    // Rebuild the empty cell index from grid
+    void buildEmptyCellIndex() {
+        emptyCells.init(SIZE, SIZE, startX, startZ);
+        for (int z = 0; z < SIZE; z++) {
+            for (int x = 0; x < SIZE; x++) {
+                if (grid[x][z] == CELL_EMPTY) emptyCells.insert(x, z);
+            }
+        }
+    }
+    
+    // Change a single cell, keeping the wall bits and empty cell index in sync
+    void setCell(int x, int z, int type) {
+        if (grid[x][z] == type) return;
+        grid[x][z] = type;
+        dirty.add(x, z);
+        revision++;
+        walls.set(x, z, type == CELL_WALL);
+        if (type == CELL_EMPTY) emptyCells.insert(x, z);
+        else emptyCells.remove(x, z);
         
+        if (type == CELL_WALL) regionsStale = true;
+        else if (!regionsStale) joinOpenNeighbours(x, z);
+    }
+    
+    void joinOpenNeighbours(int x, int z) const {
+        int dirs[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
         for (int i = 0; i < 4; i++) {
-            int nx = x + dirs[i][0];
-            int nz = z + dirs[i][1];
-            
-            if (nx > 0 && nx < SIZE - 1 && nz > 0 && nz < SIZE - 1) {
-                if (grid[nx][nz] == CELL_WALL) {
-                    // Carve path
-                    grid[x + dirs[i][0] / 2][z + dirs[i][1] / 2] = CELL_EMPTY;
-                    generatePaths(nx, nz);
-                }
+            int nx = x + dirs[i][0], nz = z + dirs[i][1];
+            if (getCell(nx, nz) != CELL_WALL) regions.unite(cellId(x, z), cellId(nx, nz));
+        }
+    }
+    
+    // Rebuild the connectivity sets from grid
+    void rebuildRegions() const {
+        regions.reset(SIZE * SIZE);
+        for (int x = 0; x < SIZE; x++) {
+            for (int z = 0; z < SIZE; z++) {
+                if (grid[x][z] == CELL_WALL) continue;
+                if (getCell(x + 1, z) != CELL_WALL) regions.unite(cellId(x, z), cellId(x + 1, z));
+                if (getCell(x, z + 1) != CELL_WALL) regions.unite(cellId(x, z), cellId(x, z + 1));
             }
         }
+        regionsStale = false;
+    }
+    
+    // True if two open cells are joined by a path (O(α(n)) unless stale)
+    bool isConnected(int ax, int az, int bx, int bz) const {
+        if (getCell(ax, az) == CELL_WALL || getCell(bx, bz) == CELL_WALL) return false;
+        if (regionsStale) rebuildRegions();
+        return regions.connected(cellId(ax, az), cellId(bx, bz));
     }
     
     // Ensure there's a path from start to exit
     void ensurePathToExit() {
-        // Simple: create a direct path if needed
-        int x = startX;
-        int z = startZ;
-        
-        while (x != exitX || z != exitZ) {
-            if (x < exitX) {
-                x++;
-                if (grid[x][z] == CELL_WALL) grid[x][z] = CELL_EMPTY;
-            } else if (x > exitX) {
-                x--;
-                if (grid[x][z] == CELL_WALL) grid[x][z] = CELL_EMPTY;
+        connectCells(startX, startZ, exitX, exitZ);
+    }
+    
+    // If (bx, bz) is not reachable from (ax, az), open the fewest walls that
+    // join them (0-1 BFS: open cells cost 0, interior walls cost 1).
+    // Returns the number of walls carved.
+    int connectCells(int ax, int az, int bx, int bz) {
+        if (isConnected(ax, az, bx, bz)) return 0;
+        
+        const int N = SIZE * SIZE;
+        int dist[N];
+        int prev[N];
+        int deque[2 * N];
+        int head = N, tail = N;
+        for (int i = 0; i < N; i++) { dist[i] = N; prev[i] = -1; }
+        
+        int source = cellId(ax, az);
+        int target = cellId(bx, bz);
+        dist[source] = 0;
+        deque[tail++] = source;
+        
+        while (head < tail) {
+            int c = deque[head++];
+            if (c == target) break;
+            int x = c % SIZE, z = c / SIZE;
+            
+            int dirs[4][2] = {{0, -1}, {1, 0}, {0, 1}, {-1, 0}};
+            for (int i = 0; i < 4; i++) {
+                int nx = x + dirs[i][0], nz = z + dirs[i][1];
+                // Never carve the outer border
+                if (nx < 1 || nx > SIZE - 2 || nz < 1 || nz > SIZE - 2) continue;
+                
+                int n = cellId(nx, nz);
+                int w = (grid[nx][nz] == CELL_WALL) ? 1 : 0;
+                if (dist[c] + w >= dist[n]) continue;
+                
+                dist[n] = dist[c] + w;
+                prev[n] = c;
+                if (w == 0) deque[--head] = n;
+                else deque[tail++] = n;
+            }
+        }
+        
+        int carved = 0;
+        for (int c = target; c != -1; c = prev[c]) {
+            int x = c % SIZE, z = c / SIZE;
+            if (grid[x][z] == CELL_WALL) {
+                setCell(x, z, CELL_EMPTY);
+                carved++;
+            }
+        }
+        return carved;
+    }
+    
+    // ========================================================================
+    // SHIFTING WALLS
+    // Rooms sit on odd coordinates; the cells between them are passages.
+    // A block of rooms is re-carved in place: passages inside the block are
+    // rebuilt as a random spanning tree, rooms and the passages leading out
+    // of the block are untouched, so the rest of the maze never changes.
+    // ========================================================================
+    static int cellId(int x, int z) { return z * SIZE + x; }
+    
+    // Number of rooms along one axis
+    static int roomCount() { return (SIZE - 1) / 2; }
+    
+    // Re-carve the rooms x in [roomX0, roomX0 + rooms), z likewise.
+    // Cells listed in keepOpen (cellId) must stay open, otherwise the block
+    // is restored and false is returned. Exit and keepOpen cells are then
+    // kept reachable from start, with minimal repair carving if needed.
+    bool recarveRegion(int roomX0, int roomZ0, int rooms, const std::vector<int>& keepOpen) {
+        int cx0 = 2 * roomX0 + 1, cz0 = 2 * roomZ0 + 1;
+        int cx1 = 2 * (roomX0 + rooms - 1) + 1, cz1 = 2 * (roomZ0 + rooms - 1) + 1;
+        if (rooms < 2 || cx0 < 1 || cz0 < 1 || cx1 > SIZE - 2 || cz1 > SIZE - 2) return false;
+        
+        // Save the block so it can be restored
+        int saved[SIZE * SIZE];
+        for (int x = cx0; x <= cx1; x++) {
+            for (int z = cz0; z <= cz1; z++) {
+                saved[cellId(x, z)] = grid[x][z];
+            }
+        }
+        
+        // Close every non-room cell inside the block
+        for (int x = cx0; x <= cx1; x++) {
+            for (int z = cz0; z <= cz1; z++) {
+                bool room = (x % 2 == 1) && (z % 2 == 1);
+                if (!room) setCell(x, z, CELL_WALL);
             }
+        }
+        
+        carveBlock(cx0, cz0, cx1, cz1);
+        
+        // Protected cells must still be open
+        for (size_t i = 0; i < keepOpen.size(); i++) {
+            if (grid[keepOpen[i] % SIZE][keepOpen[i] / SIZE] != CELL_WALL) continue;
             
-            if (z < exitZ) {
-                z++;
-                if (grid[x][z] == CELL_WALL) grid[x][z] = CELL_EMPTY;
-            } else if (z > exitZ) {
-                z--;
-                if (grid[x][z] == CELL_WALL) grid[x][z] = CELL_EMPTY;
+            for (int x = cx0; x <= cx1; x++) {
+                for (int z = cz0; z <= cz1; z++) {
+                    setCell(x, z, saved[cellId(x, z)]);
+                }
             }
+            return false;
+        }
+        
+        // Keep exit and protected cells reachable from start
+        ensurePathToExit();
+        for (size_t i = 0; i < keepOpen.size(); i++) {
+            connectCells(startX, startZ, keepOpen[i] % SIZE, keepOpen[i] / SIZE);
         }
+        return true;
+    }
+    
+    // Random spanning tree over the rooms of a block (iterative backtracker)
+    void carveBlock(int cx0, int cz0, int cx1, int cz1) {
+        bool visited[SIZE][SIZE] = {};
+        int stack[SIZE * SIZE];
+        int top = 0;
+        
+        stack[top++] = cellId(cx0, cz0);
+        visited[cx0][cz0] = true;
+        
+        while (top > 0) {
+            int x = stack[top - 1] % SIZE, z = stack[top - 1] / SIZE;
+            
+            int dirs[4][2] = {{0, -2}, {2, 0}, {0, 2}, {-2, 0}};
+            int options[4];
+            int count = 0;
+            for (int i = 0; i < 4; i++) {
+                int nx = x + dirs[i][0], nz = z + dirs[i][1];
+                if (nx >= cx0 && nx <= cx1 && nz >= cz0 && nz <= cz1 && !visited[nx][nz]) {
+                    options[count++] = i;
+                }
+            }
+            
+            if (count == 0) { top--; continue; }
+            
+            int d = options[rand() % count];
+            int nx = x + dirs[d][0], nz = z + dirs[d][1];
+            setCell(x + dirs[d][0] / 2, z + dirs[d][1] / 2, CELL_EMPTY);
+            visited[nx][nz] = true;
+            stack[top++] = cellId(nx, nz);
+        }
+    }
+    
+    // True if exit and every listed cell are reachable from start
+    bool isConnectedToStart(const std::vector<int>& targets) const {
+        if (!isConnected(startX, startZ, exitX, exitZ)) return false;
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (!isConnected(startX, startZ, targets[i] % SIZE, targets[i] / SIZE)) return false;
+        }
+        return true;
+    }
+    
+    // Return the changed-cell box and reset it
+    DirtyRect takeDirty() {
+        DirtyRect r = dirty;
+        dirty.clear();
+        return r;
     }
     
     // Convert grid coordinates to world coordinates
@@ -151,26 +453,24 @@ public:
         int gx, gz;
         worldToGrid(pos, gx, gz);
         
-        // Check nearby cells
-        for (int dx = -1; dx <= 1; dx++) {
-            for (int dz = -1; dz <= 1; dz++) {
+        // Check nearby cells, skipping whole rows with no walls
+        for (int dz = -1; dz <= 1; dz++) {
+            int z = gz + dz;
+            if (!walls.anyWallInSpan(z, gx - 1, gx + 1)) continue;
+            
+            for (int dx = -1; dx <= 1; dx++) {
                 int x = gx + dx;
-                int z = gz + dz;
                 
-                if (x >= 0 && x < SIZE && z >= 0 && z < SIZE) {
-                    int cell = grid[x][z];
-                    if (cell == CELL_WALL) {
-                        
-                        Vec4 wallPos = gridToWorld(x, z);
-                        float halfCell = cellSize / 2 - 0.1f;
-                        
-                        // AABB collision
-                        if (pos.x + radius > wallPos.x - halfCell &&
-                            pos.x - radius < wallPos.x + halfCell &&
-                            pos.z + radius > wallPos.z - halfCell &&
-                            pos.z - radius < wallPos.z + halfCell) {
-                            return true;
-                        }
+                if (x >= 0 && x < SIZE && walls.isWall(x, z)) {
+                    Vec4 wallPos = gridToWorld(x, z);
+                    float halfCell = cellSize / 2 - 0.1f;
+                    
+                    // AABB collision
+                    if (pos.x + radius > wallPos.x - halfCell &&
+                        pos.x - radius < wallPos.x + halfCell &&
+                        pos.z + radius > wallPos.z - halfCell &&
+                        pos.z - radius < wallPos.z + halfCell) {
+                        return true;
                     }
                 }
             }
@@ -194,12 +494,16 @@ public:
         return CELL_WALL;
     }
 
-    // Get a random empty cell
-    void getRandomEmptyCell(int& x, int& z) {
-        do {
-            x = rand() % SIZE;
-            z = rand() % SIZE;
-        } while (grid[x][z] != CELL_EMPTY);
+    // Get a random empty cell (uniform, O(1)). Returns false (x, z left
+    // unchanged) if the maze has no empty cell.
+    bool getRandomEmptyCell(int& x, int& z) const {
+        return emptyCells.sample(x, z);
+    }
+    
+    // Get a random empty cell at least minDist cells (ring distance) from
+    // the start. Returns false if no empty cell is that far away.
+    bool getRandomEmptyCellAwayFromStart(int minDist, int& x, int& z) const {
+        return emptyCells.sampleAtLeast(minDist, x, z);
     }
 };
 
@@ -0,0 +1,378 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Binary Maze File Header
+ *
+ * Versioned .smaz format, loaded zero-copy with mmap:
+ *
+ *   offset 0     MazeFileHeader (64 bytes)
+ *   offset 64    MazeFileSection table (MAZEFILE_MAX_SECTIONS entries)
+ *   aligned      GRID section: wall bits in BitGrid row layout
+ *                (wordsPerRow 64-bit words per row, 1 = wall)
+ *   aligned      optional sections (SDF, MESH, ...)
+ *
+ * All integers are little-endian. Section offsets are 64-byte aligned so
+ * the grid words can be used in place from the mapping.
+ ******************************************************************************/
+
+#ifndef MAZEFILE_H
+#define MAZEFILE_H
+
+#include "bitgrid.h"
+#include "generators.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ============================================================================
+// ON-DISK LAYOUT
+// ============================================================================
+const char MAZEFILE_MAGIC[4] = {'S', 'M', 'A', 'Z'};
+const uint16_t MAZEFILE_VERSION = 1;
+const int MAZEFILE_MAX_SECTIONS = 8;
+const int MAZEFILE_ALIGN = 64;
+
+enum MazeFileSectionType {
+    SECTION_GRID = 1,   // Bit-packed walls (required)
+    SECTION_SDF = 2,    // uint8 per cell: city-block distance to nearest wall
+    SECTION_MESH = 3    // Baked wall mesh (renderer-defined layout)
+};
+
+struct MazeFileHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t width, height;
+    uint32_t wordsPerRow;
+    int32_t startX, startZ;
+    int32_t exitX, exitZ;
+    int32_t keyX, keyZ;         // -1 if no preset key cell
+    uint32_t sectionCount;
+    uint32_t reserved[4];
+};
+
+struct MazeFileSection {
+    uint32_t type;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Start/exit/key cells stored alongside the grid
+struct MazeFilePositions {
+    int startX, startZ;
+    int exitX, exitZ;
+    int keyX, keyZ;
+
+    MazeFilePositions() : startX(1), startZ(1), exitX(-1), exitZ(-1), keyX(-1), keyZ(-1) {}
+};
+
+inline uint64_t alignOffset(uint64_t offset) {
+    return (offset + MAZEFILE_ALIGN - 1) & ~(uint64_t)(MAZEFILE_ALIGN - 1);
+}
+
+// ============================================================================
+// WRITER - Streams rows straight to disk (works as a MazeRowSink)
+// ============================================================================
+class MazeFileWriter : public MazeRowSink {
+public:
+    MazeFilePositions positions;
+
+    MazeFileWriter() : file(NULL), position(0), failed(false), sectionCount(0) {
+        memset(&header, 0, sizeof(header));
+        memset(sections, 0, sizeof(sections));
+    }
+
+    ~MazeFileWriter() { close(); }
+
+    bool open(const char* path) {
+        close();
+        file = fopen(path, "wb");
+        failed = (file == NULL);
+        position = 0;
+        sectionCount = 0;
+        return !failed;
+    }
+
+    // Reserve header and section table, start the grid section
+    void beginMaze(int width, int height) {
+        header.width = width;
+        header.height = height;
+        header.wordsPerRow = BitGrid::strideFor(width);
+
+        uint64_t tableEnd = sizeof(MazeFileHeader) + sizeof(sections);
+        std::vector<char> zeros((size_t)alignOffset(tableEnd), 0);
+        writeBytes(&zeros[0], zeros.size());
+
+        MazeFileSection& grid = sections[sectionCount++];
+        grid.type = SECTION_GRID;
+        grid.offset = position;
+        grid.size = (uint64_t)header.wordsPerRow * height * sizeof(uint64_t);
+    }
+
+    void writeRow(int z, const uint64_t* row) {
+        (void)z;
+        writeBytes(row, header.wordsPerRow * sizeof(uint64_t));
+    }
+
+    // Append an optional section (call after the grid rows)
+    bool addSection(uint32_t type, const void* data, uint64_t size) {
+        if (sectionCount >= MAZEFILE_MAX_SECTIONS) return false;
+        padTo(alignOffset(position));
+        MazeFileSection& s = sections[sectionCount++];
+        s.type = type;
+        s.offset = position;
+        s.size = size;
+        writeBytes(data, (size_t)size);
+        return !failed;
+    }
+
+    // Patch header and section table; returns false on any I/O error
+    bool finish() {
+        if (!file) return false;
+
+        memcpy(header.magic, MAZEFILE_MAGIC, 4);
+        header.version = MAZEFILE_VERSION;
+        header.headerSize = sizeof(MazeFileHeader);
+        header.startX = positions.startX;
+        header.startZ = positions.startZ;
+        header.exitX = positions.exitX >= 0 ? positions.exitX : (int)header.width - 2;
+        header.exitZ = positions.exitZ >= 0 ? positions.exitZ : (int)header.height - 2;
+        header.keyX = positions.keyX;
+        header.keyZ = positions.keyZ;
+        header.sectionCount = sectionCount;
+
+        if (fseek(file, 0, SEEK_SET) != 0) failed = true;
+        if (fwrite(&header, sizeof(header), 1, file) != 1) failed = true;
+        if (fwrite(sections, sizeof(sections), 1, file) != 1) failed = true;
+
+        bool ok = !failed;
+        close();
+        return ok;
+    }
+
+    void close() {
+        if (file) fclose(file);
+        file = NULL;
+    }
+
+private:
+    FILE* file;
+    uint64_t position;
+    bool failed;
+    MazeFileHeader header;
+    MazeFileSection sections[MAZEFILE_MAX_SECTIONS];
+    uint32_t sectionCount;
+
+    void writeBytes(const void* data, size_t size) {
+        if (!file || failed) return;
+        if (size > 0 && fwrite(data, size, 1, file) != 1) failed = true;
+        position += size;
+    }
+
+    void padTo(uint64_t offset) {
+        static const char zeros[MAZEFILE_ALIGN] = {0};
+        if (offset > position) writeBytes(zeros, (size_t)(offset - position));
+    }
+};
+
+// City-block distance from every cell to the nearest wall, clamped to 255
+// (two-pass chamfer transform)
+inline void bakeDistanceField(const BitGrid& walls, std::vector<uint8_t>& out) {
+    int w = walls.width, h = walls.height;
+    out.assign((size_t)w * h, 0);
+
+    // Forward pass: left and up neighbours (outside the grid counts as wall)
+    for (int z = 0; z < h; z++) {
+        for (int x = 0; x < w; x++) {
+            int d = 0;
+            if (!walls.isWall(x, z)) {
+                int left = (x > 0) ? out[(size_t)z * w + x - 1] : 0;
+                int up = (z > 0) ? out[(size_t)(z - 1) * w + x] : 0;
+                d = std::min(255, std::min(left, up) + 1);
+            }
+            out[(size_t)z * w + x] = (uint8_t)d;
+        }
+    }
+    
+    // Backward pass: right and down neighbours
+    for (int z = h - 1; z >= 0; z--) {
+        for (int x = w - 1; x >= 0; x--) {
+            if (walls.isWall(x, z)) continue;
+            int right = (x < w - 1) ? out[(size_t)z * w + x + 1] : 0;
+            int down = (z < h - 1) ? out[(size_t)(z + 1) * w + x] : 0;
+            int d = std::min((int)out[(size_t)z * w + x], std::min(right, down) + 1);
+            out[(size_t)z * w + x] = (uint8_t)d;
+        }
+    }
+}
+
+// Write a whole grid in one call
+inline bool writeMazeFile(const char* path, const BitGrid& walls,
+                          const MazeFilePositions& positions, bool withDistanceField) {
+    MazeFileWriter writer;
+    if (!writer.open(path)) return false;
+    writer.positions = positions;
+    writer.beginMaze(walls.width, walls.height);
+    for (int z = 0; z < walls.height; z++) writer.writeRow(z, walls.row(z));
+    if (withDistanceField) {
+        std::vector<uint8_t> sdf;
+        bakeDistanceField(walls, sdf);
+        writer.addSection(SECTION_SDF, sdf.empty() ? NULL : &sdf[0], sdf.size());
+    }
+    return writer.finish();
+}
+
+// ============================================================================
+// MAPPED FILE - Zero-copy read access
+// Mapped copy-on-write: runtime edits (shifting walls) touch private pages
+// only and never reach the file.
+// ============================================================================
+class MappedMazeFile {
+public:
+    MappedMazeFile() : base(NULL), length(0) {
+#ifdef _WIN32
+        fileHandle = INVALID_HANDLE_VALUE;
+        mapHandle = NULL;
+#endif
+    }
+
+    ~MappedMazeFile() { close(); }
+
+    bool isOpen() const { return base != NULL; }
+
+    // Map and validate; prints the reason and returns false on failure
+    bool open(const char* path) {
+        close();
+        if (!mapFile(path)) {
+            printf("Cannot map maze file '%s'\n", path);
+            return false;
+        }
+        if (!validate()) {
+            printf("Invalid maze file '%s'\n", path);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    const MazeFileHeader& header() const {
+        return *(const MazeFileHeader*)base;
+    }
+
+    // Grid words in BitGrid layout, usable in place
+    uint64_t* gridWords() {
+        uint64_t size;
+        return (uint64_t*)section(SECTION_GRID, size);
+    }
+
+    // Pointer to a section's payload, or NULL if the file has none
+    void* section(uint32_t type, uint64_t& size) {
+        const MazeFileSection* table = (const MazeFileSection*)(base + sizeof(MazeFileHeader));
+        for (uint32_t i = 0; i < header().sectionCount; i++) {
+            if (table[i].type == type) {
+                size = table[i].size;
+                return base + table[i].offset;
+            }
+        }
+        size = 0;
+        return NULL;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (base) UnmapViewOfFile(base);
+        if (mapHandle) CloseHandle(mapHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mapHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (base) munmap(base, length);
+#endif
+        base = NULL;
+        length = 0;
+    }
+
+private:
+    char* base;
+    uint64_t length;
+#ifdef _WIN32
+    HANDLE fileHandle;
+    HANDLE mapHandle;
+#endif
+
+    // Non-copyable (owns the mapping)
+    MappedMazeFile(const MappedMazeFile&);
+    MappedMazeFile& operator=(const MappedMazeFile&);
+
+    bool mapFile(const char* path) {
+#ifdef _WIN32
+        fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                 OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(fileHandle, &size)) return false;
+        length = (uint64_t)size.QuadPart;
+        mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (!mapHandle) return false;
+        base = (char*)MapViewOfFile(mapHandle, FILE_MAP_COPY, 0, 0, 0);
+        return base != NULL;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+        length = (uint64_t)st.st_size;
+        void* p = mmap(NULL, (size_t)length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base = (char*)p;
+        return true;
+#endif
+    }
+
+    static bool cellInGrid(const MazeFileHeader& h, int32_t x, int32_t z) {
+        return x >= 0 && z >= 0 && (uint32_t)x < h.width && (uint32_t)z < h.height;
+    }
+
+    bool validate() const {
+        if (length < sizeof(MazeFileHeader) + sizeof(MazeFileSection) * MAZEFILE_MAX_SECTIONS) return false;
+        const MazeFileHeader& h = header();
+        if (memcmp(h.magic, MAZEFILE_MAGIC, 4) != 0) return false;
+        if (h.version != MAZEFILE_VERSION || h.headerSize != sizeof(MazeFileHeader)) return false;
+        if (h.width == 0 || h.height == 0) return false;
+        if (h.wordsPerRow != (uint32_t)BitGrid::strideFor(h.width)) return false;
+        if (h.sectionCount > (uint32_t)MAZEFILE_MAX_SECTIONS) return false;
+
+        // Readers index the grid with these, so they must lie inside it
+        if (!cellInGrid(h, h.startX, h.startZ) || !cellInGrid(h, h.exitX, h.exitZ)) return false;
+        bool noKey = h.keyX == -1 && h.keyZ == -1;
+        if (!noKey && !cellInGrid(h, h.keyX, h.keyZ)) return false;
+
+        const MazeFileSection* table = (const MazeFileSection*)(base + sizeof(MazeFileHeader));
+        bool hasGrid = false;
+        for (uint32_t i = 0; i < h.sectionCount; i++) {
+            if (table[i].offset % MAZEFILE_ALIGN != 0) return false;
+            if (table[i].offset > length || table[i].size > length - table[i].offset) return false;
+            if (table[i].type == SECTION_GRID) {
+                hasGrid = true;
+                if (table[i].size != (uint64_t)h.wordsPerRow * h.height * sizeof(uint64_t)) return false;
+            }
+        }
+        return hasGrid;
+    }
+};
+
+#endif // MAZEFILE_H
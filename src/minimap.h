@@ -0,0 +1,192 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Minimap Header
+ *
+ * Top-down map of the maze kept in a texture:
+ * - Walls are rasterized once per maze, and again only for the texels a
+ *   shift touched (glTexSubImage2D of the dirty box)
+ * - Each frame draws one textured quad plus a handful of markers, so the
+ *   cost does not depend on the maze size
+ * - Mazes larger than the texture are box-filtered: a texel covers
+ *   cellsPerTexel x cellsPerTexel cells and shows their open fraction
+ ******************************************************************************/
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/gl.h>
+
+#include "config.h"
+#include "bitgrid.h"
+#include "framestats.h"
+
+#include <vector>
+#include <algorithm>
+
+class Minimap {
+public:
+    Minimap() : texture(0), texSize(0), mazeWidth(0), mazeHeight(0),
+                cellsPerTexel(1), usedWidth(0), usedHeight(0), exitX(-1), exitZ(-1),
+                screenX(0), screenY(0), screenScale(1) {}
+
+    int textureSize() const { return texSize; }
+    int cellsPerTexelSide() const { return cellsPerTexel; }
+
+    // ========================================================================
+    // RASTERIZATION
+    // ========================================================================
+
+    // Rasterize the whole maze (new maze or new size)
+    void rebuild(const BitGrid& walls, int exitCellX, int exitCellZ) {
+        mazeWidth = walls.width;
+        mazeHeight = walls.height;
+        exitX = exitCellX;
+        exitZ = exitCellZ;
+
+        // No more texels per side than the minimap has pixels: a maze wider
+        // than MINIMAP_SIZE is downsampled, then the smallest power-of-two
+        // texture holding the used texels is allocated
+        int maxSide = std::max(mazeWidth, mazeHeight);
+        int maxTexels = std::max(1, (int)Config::MINIMAP_SIZE);
+        cellsPerTexel = (maxSide + maxTexels - 1) / maxTexels;
+        texSize = nextPowerOfTwo((maxSide + cellsPerTexel - 1) / cellsPerTexel);
+        usedWidth = (mazeWidth + cellsPerTexel - 1) / cellsPerTexel;
+        usedHeight = (mazeHeight + cellsPerTexel - 1) / cellsPerTexel;
+
+        pixels.assign(texSize * texSize * 3, 0);
+        for (int tz = 0; tz < usedHeight; tz++) {
+            for (int tx = 0; tx < usedWidth; tx++) {
+                rasterTexel(walls, tx, tz);
+            }
+        }
+
+        if (!texture) glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texSize, texSize, 0,
+                     GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // Re-rasterize the texels covering cells [x0, x1] x [z0, z1]
+    void update(const BitGrid& walls, int x0, int z0, int x1, int z1) {
+        if (!texture || walls.width != mazeWidth || walls.height != mazeHeight) {
+            rebuild(walls, exitX, exitZ);
+            return;
+        }
+
+        int tx0 = std::max(0, x0) / cellsPerTexel;
+        int tz0 = std::max(0, z0) / cellsPerTexel;
+        int tx1 = std::min(mazeWidth - 1, x1) / cellsPerTexel;
+        int tz1 = std::min(mazeHeight - 1, z1) / cellsPerTexel;
+        if (tx0 > tx1 || tz0 > tz1) return;
+
+        for (int tz = tz0; tz <= tz1; tz++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                rasterTexel(walls, tx, tz);
+            }
+        }
+
+        // Upload the sub-rectangle straight out of the full pixel array
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, texSize);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, tx0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, tz0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, tx0, tz0, tx1 - tx0 + 1, tz1 - tz0 + 1,
+                        GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // ========================================================================
+    // DRAWING (2D projection must be active)
+    // North (-z) is up; (x, y) is the bottom-left corner in window pixels.
+    // ========================================================================
+    void draw(float x, float y, float size) {
+        if (!texture) return;
+        screenX = x;
+        screenY = y;
+        screenScale = size / std::max(mazeWidth, mazeHeight);
+
+        float w = mazeWidth * screenScale;
+        float h = mazeHeight * screenScale;
+        float s = (float)usedWidth / texSize;
+        float t = (float)usedHeight / texSize;
+
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glColor3f(1.0f, 1.0f, 1.0f);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0, t); glVertex2f(x, y + size - h);
+        glTexCoord2f(s, t); glVertex2f(x + w, y + size - h);
+        glTexCoord2f(s, 0); glVertex2f(x + w, y + size);
+        glTexCoord2f(0, 0); glVertex2f(x, y + size);
+        glEnd();
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+        countVertices(4);
+    }
+
+    // Marker at a fractional cell position (cell units, from the maze corner).
+    // Emits one vertex; call inside glBegin()/glEnd() after draw().
+    void marker(float cellX, float cellZ) const {
+        glVertex2f(screenX + cellX * screenScale,
+                   screenY + (std::max(mazeWidth, mazeHeight) - cellZ) * screenScale);
+        countVertices(1);
+    }
+
+private:
+    GLuint texture;
+    int texSize;
+    int mazeWidth, mazeHeight;
+    int cellsPerTexel;
+    int usedWidth, usedHeight;      // Texels covered by the maze
+    int exitX, exitZ;
+    std::vector<unsigned char> pixels;  // RGB, row = texel z
+
+    // Placement of the last draw(), used by marker()
+    float screenX, screenY, screenScale;
+
+    static int nextPowerOfTwo(int n) {
+        int p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // Average the cells under one texel: wall colour -> floor colour by the
+    // open fraction; the exit always shows
+    void rasterTexel(const BitGrid& walls, int tx, int tz) {
+        int x0 = tx * cellsPerTexel, z0 = tz * cellsPerTexel;
+        int x1 = std::min(mazeWidth, x0 + cellsPerTexel);
+        int z1 = std::min(mazeHeight, z0 + cellsPerTexel);
+
+        int open = 0;
+        for (int z = z0; z < z1; z++) {
+            for (int x = x0; x < x1; x++) {
+                if (!walls.isWall(x, z)) open++;
+            }
+        }
+        float f = (float)open / ((x1 - x0) * (z1 - z0));
+
+        unsigned char* p = &pixels[(tz * texSize + tx) * 3];
+        if (exitX >= x0 && exitX < x1 && exitZ >= z0 && exitZ < z1) {
+            p[0] = 255; p[1] = 200; p[2] = 0;
+            return;
+        }
+        p[0] = (unsigned char)(40 + f * 160);
+        p[1] = (unsigned char)(35 + f * 170);
+        p[2] = (unsigned char)(30 + f * 150);
+    }
+};
+
+#endif // MINIMAP_H
@@ -0,0 +1,438 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Render Backend Header
+ *
+ * One interface for every way the scene can reach the screen:
+ * - beginFrame(frame) takes the camera, lights, viewport and fog
+ * - submit() queues a mesh (MeshId) with a transform and material id;
+ *   submitUnlit() draws a local mesh in one flat colour, drawLines() a
+ *   world-space line strip
+ * - endFrame() draws everything submitted; HUD primitives follow between
+ *   beginHud() and endHud() in window pixels (origin bottom left)
+ * Implementations:
+ *   immediate  RenderQueue, CPU transforms, one glBegin batch per material
+ *   retained   RenderQueue in GL-matrix mode (cached local meshes, arrays)
+ *   instanced  one InstanceBatch per (material, mesh, detail) per frame;
+ *              glDrawElementsInstanced with shader lighting
+ *   software   SoftRasterizer on the worker pool; blitted when presenting,
+ *              otherwise the frame stays in its Framebuffer (headless)
+ * All of them share one MaterialTable, so ids work with any backend.
+ ******************************************************************************/
+
+#ifndef RENDERBACKEND_H
+#define RENDERBACKEND_H
+
+#include "config.h"
+#include "matrix.h"
+#include "lighting.h"
+#include "lightgrid.h"
+#include "draw.h"
+#include "instancing.h"
+#include "renderqueue.h"
+#include "shader.h"
+#include "softraster.h"
+#include "workers.h"
+
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <cstring>
+
+// Camera, lights and output of one frame
+struct FrameSetup {
+    Matrix4x4 projection;
+    Matrix4x4 view;
+    Vec4 viewPos;
+    LightSet lights;
+    int width, height;
+    Color clearColor;
+    Color fogColor;
+    float fogDensity;           // GL_EXP; 0 = no fog
+
+    FrameSetup() : width(0), height(0), fogDensity(0) {}
+};
+
+// ============================================================================
+// INTERFACE
+// ============================================================================
+class RenderBackend {
+public:
+    // Statistics of the last frame
+    int itemCount;
+    int batchCount;
+
+    explicit RenderBackend(const MaterialTable* table)
+        : itemCount(0), batchCount(0), materials(table) {}
+    virtual ~RenderBackend() {}
+
+    virtual const char* name() const = 0;
+
+    virtual void beginFrame(const FrameSetup& setup) = 0;
+    virtual void submit(int material, int mesh, const Matrix4x4& transform,
+                        float param0 = 0, float param1 = 0, int lod = 0) = 0;
+    virtual void submitUnlit(const LocalMesh& mesh, const Matrix4x4& transform, const Color& color) = 0;
+    virtual void drawLines(const Vec4* points, int count, const Color& color, float width) = 0;
+    virtual void endFrame() = 0;
+
+    virtual void beginHud() = 0;
+    virtual void hudPoints(const PointBuffer& points, const Color& color) = 0;
+    virtual void endHud() = 0;
+
+    // Per-pixel lighting; false if this backend cannot use the shader
+    virtual bool setShader(PhongShader* shader) { return shader == NULL; }
+
+    void pushCube(int material, const Matrix4x4& transform) { submit(material, MESH_CUBE, transform); }
+
+protected:
+    const MaterialTable* materials;
+    FrameSetup frame;
+
+private:
+    RenderBackend(const RenderBackend&);
+    RenderBackend& operator=(const RenderBackend&);
+};
+
+// ============================================================================
+// GL BACKENDS
+// ============================================================================
+
+// 2D window-pixel projection for HUD drawing; undone by endHud2D()
+inline void beginHud2D(int width, int height) {
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, width, 0, height);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+}
+
+inline void endHud2D() {
+    glEnable(GL_DEPTH_TEST);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+}
+
+// Matrices, clearing, unlit meshes, lines and HUD through fixed-function GL
+class GLBackend : public RenderBackend {
+public:
+    explicit GLBackend(const MaterialTable* table) : RenderBackend(table) {}
+
+    void beginFrame(const FrameSetup& setup) {
+        frame = setup;
+        glClearColor(frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        GLfloat fog[] = {frame.fogColor.r, frame.fogColor.g, frame.fogColor.b, 1.0f};
+        glFogfv(GL_FOG_COLOR, fog);
+        glFogf(GL_FOG_DENSITY, frame.fogDensity);
+
+        glMatrixMode(GL_PROJECTION);
+        glLoadMatrixf(frame.projection.ptr());
+        glMatrixMode(GL_MODELVIEW);
+        glLoadMatrixf(frame.view.ptr());
+    }
+
+    void submitUnlit(const LocalMesh& mesh, const Matrix4x4& transform, const Color& color) {
+        glPushMatrix();
+        glMultMatrixf(transform.ptr());
+        glColor3f(color.r, color.g, color.b);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, sizeof(Vec4), &mesh.positions[0].x);
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indexCount(), GL_UNSIGNED_INT, &mesh.indices[0]);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glPopMatrix();
+        countVertices(mesh.vertexCount());
+    }
+
+    void drawLines(const Vec4* points, int count, const Color& color, float width) {
+        glColor3f(color.r, color.g, color.b);
+        glLineWidth(width);
+        glBegin(GL_LINE_STRIP);
+        for (int i = 0; i < count; i++) glVertex3f(points[i].x, points[i].y, points[i].z);
+        glEnd();
+        glLineWidth(1.0f);
+        countVertices(count);
+    }
+
+    void beginHud() { beginHud2D(frame.width, frame.height); }
+
+    void hudPoints(const PointBuffer& points, const Color& color) {
+        glColor3f(color.r, color.g, color.b);
+        points.draw();
+    }
+
+    void endHud() { endHud2D(); }
+};
+
+// Sorted RenderQueue flushed at the end of the frame
+class QueueBackend : public GLBackend {
+public:
+    RenderQueue queue;
+
+    QueueBackend(const MaterialTable* table, bool glMatrices) : GLBackend(table), queue(table) {
+        queue.useGLMatrices = glMatrices;
+    }
+
+    void beginFrame(const FrameSetup& setup) {
+        GLBackend::beginFrame(setup);
+        queue.setViewMatrix(frame.view);
+    }
+
+    void submit(int material, int mesh, const Matrix4x4& transform,
+                float param0 = 0, float param1 = 0, int lod = 0) {
+        queue.push(material, mesh, transform, param0, param1, lod);
+    }
+
+    void endFrame() {
+        queue.flush(frame.viewPos, frame.lights);
+        itemCount = queue.itemCount;
+        batchCount = queue.batchCount;
+    }
+
+    bool setShader(PhongShader* shader) {
+        queue.shader = shader;
+        return true;
+    }
+};
+
+class ImmediateBackend : public QueueBackend {
+public:
+    explicit ImmediateBackend(const MaterialTable* table) : QueueBackend(table, false) {}
+    const char* name() const { return "immediate"; }
+};
+
+class RetainedBackend : public QueueBackend {
+public:
+    explicit RetainedBackend(const MaterialTable* table) : QueueBackend(table, true) {}
+    const char* name() const { return "retained"; }
+};
+
+// Items grouped by (material, mesh, detail, params); each group is drawn
+// with one call. CPU lighting expands the group into one lit stream for
+// glDrawElements; the shader draws the shared mesh per instance with
+// glDrawElementsInstanced (frames whose grid has more lights than the
+// shader's table fall back to the CPU).
+class InstancedBackend : public GLBackend {
+public:
+    explicit InstancedBackend(const MaterialTable* table)
+        : GLBackend(table), itemsQueued(0), shader(NULL) {}
+
+    const char* name() const { return "instanced"; }
+
+    void submit(int material, int mesh, const Matrix4x4& transform,
+                float param0 = 0, float param1 = 0, int lod = 0) {
+        batchFor(material, mesh, lod, param0, param1).batch.add(transform);
+        itemsQueued++;
+    }
+
+    void endFrame() {
+        itemCount = itemsQueued;
+        batchCount = 0;
+        itemsQueued = 0;
+        bool shaded = shader && shader->beginInstanced(frame.lights, frame.viewPos);
+        for (size_t i = 0; i < groups.size(); i++) {
+            Group& g = groups[i];
+            if (g.batch.instanceCount() == 0) continue;
+            if (shaded) {
+                drawShaded(g);
+            } else {
+                g.batch.draw(frame.viewPos, frame.lights, materials->get(g.material));
+            }
+            batchCount++;
+        }
+        if (shaded) shader->end();
+    }
+
+    // Needs the instanced program (GL 3.3 or ARB_instanced_arrays)
+    bool setShader(PhongShader* s) {
+        if (s && !s->canInstance()) return false;
+        shader = s;
+        return true;
+    }
+
+private:
+    struct Group {
+        int material, mesh, lod;
+        float params[2];
+        InstanceBatch batch;
+    };
+
+    MeshCache meshes;
+    std::deque<Group> groups;       // Kept between frames with their buffers
+    int itemsQueued;
+    PhongShader* shader;
+    std::vector<InstanceAttributes> instanceData;   // Reused between frames
+
+    void drawShaded(Group& g) {
+        InstanceBatch& batch = g.batch;
+        int count = batch.instanceCount();
+        instanceData.resize(count);
+        for (int i = 0; i < count; i++) packInstance(batch.transform(i), frame.lights, instanceData[i]);
+
+        const LocalMesh& mesh = *batch.sharedMesh();
+        shader->setMaterial(materials->get(g.material));
+        shader->drawInstanced(mesh, &instanceData[0], count);
+        countVertices(mesh.vertexCount() * count);
+        batch.clear();
+    }
+
+    Group& batchFor(int material, int mesh, int lod, float param0, float param1) {
+        for (size_t i = 0; i < groups.size(); i++) {
+            Group& g = groups[i];
+            if (g.material == material && g.mesh == mesh && g.lod == lod &&
+                g.params[0] == param0 && g.params[1] == param1) {
+                return g;
+            }
+        }
+        groups.push_back(Group());
+        Group& g = groups.back();
+        g.material = material;
+        g.mesh = mesh;
+        g.lod = lod;
+        g.params[0] = param0;
+        g.params[1] = param1;
+        g.batch.setMesh(&meshes.get(mesh, lod, param0, param1));
+        return g;
+    }
+};
+
+// ============================================================================
+// SOFTWARE BACKEND
+// ============================================================================
+class SoftwareBackend : public RenderBackend {
+public:
+    Framebuffer target;
+    SoftRasterizer raster;
+    bool present;               // Blit to the GL window in beginHud()
+    float queueMs, rasterMs;    // Last endFrame(): sort, lighting and binning; tile raster
+
+    SoftwareBackend(const MaterialTable* table, WorkerPool* workerPool)
+        : RenderBackend(table), raster(workerPool), present(true), queueMs(0), rasterMs(0),
+          workers(workerPool), queue(table) {}
+
+    const char* name() const { return "software"; }
+
+    void beginFrame(const FrameSetup& setup) {
+        frame = setup;
+        target.resize(frame.width, frame.height);
+        raster.setFog(frame.fogColor, frame.fogDensity);
+        raster.begin(target, frame.projection * frame.view, frame.clearColor);
+    }
+
+    void submit(int material, int mesh, const Matrix4x4& transform,
+                float param0 = 0, float param1 = 0, int lod = 0) {
+        queue.push(material, mesh, transform, param0, param1, lod);
+    }
+
+    void submitUnlit(const LocalMesh& mesh, const Matrix4x4& transform, const Color& color) {
+        flatColors.resize(mesh.vertexCount() * 3);
+        for (int i = 0; i < mesh.vertexCount(); i++) {
+            flatColors[3 * i] = color.r;
+            flatColors[3 * i + 1] = color.g;
+            flatColors[3 * i + 2] = color.b;
+        }
+        raster.drawIndexed(transform, &mesh.positions[0], mesh.vertexCount(),
+                           &flatColors[0], &mesh.indices[0], mesh.indexCount());
+        countVertices(mesh.vertexCount());
+    }
+
+    void drawLines(const Vec4* points, int count, const Color& color, float width) {
+        raster.drawLineStrip(points, count, color, width);
+        countVertices(count);
+    }
+
+    void endFrame() {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+        queue.flushSoftware(raster, *workers, frame.viewPos, frame.lights);
+        Clock::time_point binned = Clock::now();
+        raster.end();
+        queueMs = (float)std::chrono::duration<double, std::milli>(binned - start).count();
+        rasterMs = (float)std::chrono::duration<double, std::milli>(Clock::now() - binned).count();
+        itemCount = queue.itemCount;
+        batchCount = queue.batchCount;
+    }
+
+    void beginHud() {
+        if (!present) return;
+        beginHud2D(frame.width, frame.height);
+        glDisable(GL_FOG);
+        glRasterPos2i(0, 0);
+        glDrawPixels(target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, target.pixels());
+        glEnable(GL_FOG);
+    }
+
+    // Into the framebuffer when not presenting
+    void hudPoints(const PointBuffer& points, const Color& color) {
+        if (present) {
+            glColor3f(color.r, color.g, color.b);
+            points.draw();
+            return;
+        }
+        uint32_t c = packColor(color.r, color.g, color.b);
+        for (int i = 0; i < points.size(); i++) {
+            int x = points.x(i), y = points.y(i);
+            if (x < 0 || y < 0 || x >= target.width || y >= target.height) continue;
+            target.color[y * target.width + x] = c;
+        }
+    }
+
+    void endHud() {
+        if (present) endHud2D();
+    }
+
+private:
+    WorkerPool* workers;                // Vertex lighting jobs (shared, not owned)
+    RenderQueue queue;                  // Sorting and vertex lighting
+    std::vector<float> flatColors;
+};
+
+// ============================================================================
+// BACKEND SET
+// ============================================================================
+class RenderBackends {
+public:
+    ImmediateBackend immediate;
+    RetainedBackend retained;
+    InstancedBackend instanced;
+    SoftwareBackend software;
+
+    RenderBackends(const MaterialTable* table, WorkerPool* workers)
+        : immediate(table), retained(table), instanced(table), software(table, workers) {
+        list[0] = &immediate;
+        list[1] = &retained;
+        list[2] = &instanced;
+        list[3] = &software;
+    }
+
+    static int count() { return 4; }
+    RenderBackend* get(int i) { return list[i]; }
+
+    // Look up a backend by name; NULL if unknown
+    RenderBackend* find(const char* name) {
+        for (int i = 0; i < count(); i++) {
+            if (strcmp(list[i]->name(), name) == 0) return list[i];
+        }
+        return NULL;
+    }
+
+    // The backend after current, wrapping around
+    RenderBackend* next(const RenderBackend* current) {
+        for (int i = 0; i < count(); i++) {
+            if (list[i] == current) return list[(i + 1) % count()];
+        }
+        return list[0];
+    }
+
+private:
+    RenderBackend* list[4];
+};
+
+#endif // RENDERBACKEND_H
@@ -0,0 +1,525 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Render Queue Header
+ *
+ * Deferred submission of lit meshes:
+ * - Materials are interned once into a MaterialTable and referenced by id
+ * - Draws are recorded as (material, mesh, transform) items, sorted by
+ *   material then mesh, and emitted in one glBegin/glEnd batch per run;
+ *   every mode draws the same cached local meshes, nothing is tessellated
+ *   per frame
+ * - GL-matrix mode: each item's View * Model goes to glLoadMatrixf and a
+ *   cached local-space mesh is drawn as-is; lighting runs in object space,
+ *   so no vertex or normal is transformed on the CPU
+ * - Shader mode: same local meshes, lit per pixel by a PhongShader; the
+ *   CPU only uploads matrices and material uniforms
+ * - Software mode: same local meshes and vertex lighting as GL-matrix
+ *   mode, lit on the worker pool and handed to a SoftRasterizer instead
+ *   of GL
+ ******************************************************************************/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "matrix.h"
+#include "lighting.h"
+#include "draw.h"
+#include "lod.h"
+#include "instancing.h"
+#include "shader.h"
+#include "softraster.h"
+#include "arena.h"
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+
+// ============================================================================
+// MATERIAL TABLE
+// ============================================================================
+inline bool sameColor(const Color& a, const Color& b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+inline bool sameMaterial(const Material& a, const Material& b) {
+    return sameColor(a.ambient, b.ambient) && sameColor(a.diffuse, b.diffuse) &&
+           sameColor(a.specular, b.specular) && a.shininess == b.shininess;
+}
+
+class MaterialTable {
+public:
+    // Id of an equal material, adding it if new
+    int intern(const Material& material) {
+        for (size_t i = 0; i < materials.size(); i++) {
+            if (sameMaterial(materials[i], material)) return (int)i;
+        }
+        materials.push_back(material);
+        return (int)materials.size() - 1;
+    }
+
+    const Material& get(int id) const { return materials[id]; }
+    int size() const { return (int)materials.size(); }
+    void clear() { materials.clear(); }
+
+private:
+    std::vector<Material> materials;
+};
+
+// ============================================================================
+// MESHES
+// Each mesh has LOD_LEVELS fixed tessellations; size parameters travel
+// with the item so normals are never distorted by non-uniform scale.
+// ============================================================================
+enum MeshId {
+    MESH_CUBE = 0,          // Unit cube, sized by the transform
+    MESH_SPHERE = 1,        // params[0] = radius
+    MESH_CONE = 2,          // params[0] = base radius, params[1] = height
+    MESH_QUAD = 3           // Unit quad facing +y (floor cells), sized by the transform
+};
+
+// ============================================================================
+// MESH CACHE - local-space tessellations, built once per (mesh, LOD, size)
+// ============================================================================
+class MeshCache {
+public:
+    const LocalMesh& get(int mesh, int lod, float param0, float param1) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& e = entries[i];
+            if (e.mesh == mesh && e.lod == lod && e.params[0] == param0 && e.params[1] == param1) {
+                return e.local;
+            }
+        }
+        
+        // Deque: references stay valid as entries are added
+        entries.push_back(Entry());
+        Entry& e = entries.back();
+        e.mesh = mesh;
+        e.lod = lod;
+        e.params[0] = param0;
+        e.params[1] = param1;
+        switch (mesh) {
+            case MESH_CUBE:   buildCubeMesh(e.local); break;
+            case MESH_SPHERE: buildSphereMesh(e.local, param0, SPHERE_LOD_SLICES[lod], SPHERE_LOD_STACKS[lod]); break;
+            case MESH_CONE:   buildConeMesh(e.local, param0, param1, CONE_LOD_SLICES[lod]); break;
+            case MESH_QUAD:   buildQuadMesh(e.local); break;
+        }
+        return e.local;
+    }
+
+private:
+    struct Entry {
+        int mesh, lod;
+        float params[2];
+        LocalMesh local;
+    };
+    std::deque<Entry> entries;
+};
+
+// Uniform scale of a rotation + uniform scale matrix, or 0 if the matrix
+// shears or scales non-uniformly (object-space lighting would be wrong)
+inline float similarityScale(const Affine3x4& A) {
+    Vec4 c0(A.m[0][0], A.m[0][1], A.m[0][2]);
+    Vec4 c1(A.m[1][0], A.m[1][1], A.m[1][2]);
+    Vec4 c2(A.m[2][0], A.m[2][1], A.m[2][2]);
+    float s = c0.length();
+    float tol = 1e-4f * (s + 1.0f);
+    if (fabs(c1.length() - s) > tol || fabs(c2.length() - s) > tol) return 0;
+    if (fabs(c0.dot(c1)) > tol * s || fabs(c0.dot(c2)) > tol * s || fabs(c1.dot(c2)) > tol * s) return 0;
+    return s;
+}
+
+// ============================================================================
+// VERTEX LIGHTER - per-item vertex lighting into reusable scratch streams
+// One per thread that lights items; RenderQueue keeps one for its serial
+// paths and one per job of the parallel software flush.
+// ============================================================================
+class VertexLighter {
+public:
+    std::vector<float> colorStream;             // RGB per mesh vertex
+    std::vector<unsigned int> visibleIndices;   // Triangles to draw
+
+    // Indices to draw: all of them, or for cubes (4 vertices and 6 indices
+    // per face) only faces turned towards the eye. The test is
+    // affine-invariant, so it runs in local space.
+    void selectFaces(const LocalMesh& mesh, bool cullFaces, const Vec4& localEye) {
+        if (!cullFaces) {
+            visibleIndices.assign(mesh.indices.begin(), mesh.indices.end());
+            return;
+        }
+        visibleIndices.clear();
+        int faces = mesh.vertexCount() / 4;
+        for (int f = 0; f < faces; f++) {
+            if (mesh.normals[4 * f].dot(localEye - mesh.positions[4 * f]) <= 0) continue;
+            for (int k = 0; k < 6; k++) visibleIndices.push_back(mesh.indices[6 * f + k]);
+        }
+    }
+    
+    // Fill colorStream and visibleIndices for one item. For rotation +
+    // uniform scale (+ translation) whose box sits in one cell, the eye,
+    // the primary light and that cell's grid lights move into the mesh's
+    // frame instead, with the attenuation terms absorbing the scale, so no
+    // vertex is transformed. Other matrices (non-uniform wall boxes, key
+    // teeth) and meshes straddling a cell border light in world space, each
+    // vertex looking up its own cell; only positions/normals feeding the
+    // lighting are transformed, the geometry itself still goes to GL local.
+    void light(const LocalMesh& mesh, bool cullFaces, const Affine3x4& A,
+                    const Vec4& viewPos, const LightSet& lights, const Material& material) {
+        float scale = similarityScale(A);
+        Affine3x4 inv = A.inverse();
+        Affine3x4 N = A.normalMatrix();
+        Vec4 centre(A.m[3][0], A.m[3][1], A.m[3][2]);
+        
+        bool objectSpace = false;
+        if (scale > 0) {
+            Vec4 lo, hi;
+            mesh.worldBounds(A, lo, hi);
+            objectSpace = lights.lightsForBox(lo, hi, centre, objectLights);
+        }
+        Vec4 eye = viewPos;
+        if (objectSpace) {
+            eye = inv.transformPoint(viewPos);
+            toObjectSpace(objectLights.primary, inv, scale);
+            for (int i = 0; i < objectLights.count; i++) toObjectSpace(objectLights.local[i], inv, scale);
+        }
+        
+        int verts = mesh.vertexCount();
+        colorStream.resize(verts * 3);
+        selectFaces(mesh, cullFaces, inv.transformPoint(viewPos));
+        
+        if (!cullFaces) {
+            for (int v = 0; v < verts; v++) lightVertex(mesh, v, objectSpace, A, N, centre, eye, lights, material);
+            countVertices(verts);
+            return;
+        }
+        
+        // Light the 4 vertices of each face kept
+        for (size_t k = 0; k < visibleIndices.size(); k += 6) {
+            int first = visibleIndices[k] / 4 * 4;
+            for (int v = first; v < first + 4; v++) {
+                lightVertex(mesh, v, objectSpace, A, N, centre, eye, lights, material);
+            }
+        }
+        countVertices((unsigned int)visibleIndices.size() / 6 * 4);
+    }
+    
+private:
+    ObjectLights objectLights;      // Lights of the item being lit
+
+    // Object space uses objectLights; world space looks up lights per vertex
+    void lightVertex(const LocalMesh& mesh, int v, bool objectSpace, const Affine3x4& A,
+                     const Affine3x4& N, const Vec4& centre, const Vec4& eye,
+                     const LightSet& lights, const Material& material) {
+        Color c;
+        if (objectSpace) {
+            c = calculateLighting(mesh.positions[v], mesh.normals[v], eye, objectLights, material);
+        } else {
+            Vec4 n = N.transformVector(mesh.normals[v]);
+            n.normalize();
+            Vec4 p = A.transformPoint(mesh.positions[v]);
+            c = calculateLighting(p, n, eye, lights, material, lightSamplePoint(p, centre));
+        }
+        colorStream[3 * v] = c.r;
+        colorStream[3 * v + 1] = c.g;
+        colorStream[3 * v + 2] = c.b;
+    }
+    
+    // World light -> mesh frame of a similarity with the given scale
+    static void toObjectSpace(Light& light, const Affine3x4& inv, float scale) {
+        light.position = inv.transformPoint(light.position);
+        light.linearAtt *= scale;
+        light.quadraticAtt *= scale * scale;
+    }
+};
+
+struct RenderItem {
+    Matrix4x4 transform;
+    float params[2];
+    unsigned short material;
+    unsigned char mesh;
+    unsigned char lod;
+};
+
+// ============================================================================
+// RENDER QUEUE
+// ============================================================================
+const int SOFTWARE_LIGHT_JOBS = 16;     // Runs of items lit in parallel (software mode)
+
+class RenderQueue {
+public:
+    // Ids in pushed items refer to this table (shared, not owned)
+    const MaterialTable* materials;
+
+    // Statistics of the last flush
+    int batchCount;
+    int itemCount;
+    
+    // Upload model matrices to GL instead of transforming on the CPU
+    bool useGLMatrices;
+
+    // Light per pixel with this shader when set and ready (overrides
+    // useGLMatrices; geometry goes through GL matrices as well)
+    PhongShader* shader;
+
+    explicit RenderQueue(const MaterialTable* table)
+        : materials(table), batchCount(0), itemCount(0), useGLMatrices(false), shader(NULL) {}
+    
+    // View matrix currently on GL_MODELVIEW (needed by GL-matrix mode)
+    void setViewMatrix(const Matrix4x4& view) {
+        viewMatrix = view;
+        viewAffine = Affine3x4(view);
+    }
+
+    void clear() {
+        items.clear();
+        order.clear();
+    }
+
+    void push(int material, int mesh, const Matrix4x4& transform,
+              float param0 = 0, float param1 = 0, int lod = 0) {
+        RenderItem item;
+        item.transform = transform;
+        item.params[0] = param0;
+        item.params[1] = param1;
+        item.material = (unsigned short)material;
+        item.mesh = (unsigned char)mesh;
+        item.lod = (unsigned char)lod;
+        order.push_back(SortEntry(sortKey(item), items.size()));
+        items.push_back(item);
+    }
+
+    void pushCube(int material, const Matrix4x4& transform) {
+        push(material, MESH_CUBE, transform);
+    }
+
+    // Sort by (material, mesh, lod), emit one batch per run of the same material
+    // and primitive type, then clear. Items live in the frame arena.
+    void flush(const Vec4& viewPos, const LightSet& lights) {
+        std::sort(order.begin(), order.end());
+        batchCount = 0;
+        itemCount = order.size();
+        
+        if (shader && shader->isReady()) {
+            flushWithShader(viewPos, lights);
+            clear();
+            return;
+        }
+        if (useGLMatrices) {
+            flushWithGLMatrices(viewPos, lights);
+            clear();
+            return;
+        }
+
+        // Immediate mode: the same cached meshes and vertex lighting,
+        // transformed on the CPU and emitted as triangles, one glBegin/glEnd
+        // per run of the same material
+        int i = 0;
+        while (i < order.size()) {
+            int material = items[order[i].second].material;
+
+            glBegin(GL_TRIANGLES);
+            for (; i < order.size() && items[order[i].second].material == material; i++) {
+                emitCached(items[order[i].second], viewPos, lights);
+            }
+            glEnd();
+            batchCount++;
+        }
+        clear();
+    }
+
+    // Same items as flush(), rasterized on the CPU; the caller ends the
+    // frame. Items are lit in parallel, SOFTWARE_LIGHT_JOBS contiguous runs
+    // of the sorted order, each job with its own lighter and counters; they
+    // then reach the rasterizer in order on this thread, so the image does
+    // not depend on the thread count.
+    void flushSoftware(SoftRasterizer& raster, WorkerPool& workers,
+                       const Vec4& viewPos, const LightSet& lights) {
+        std::sort(order.begin(), order.end());
+        batchCount = 0;
+        itemCount = order.size();
+
+        // Mesh lookups may fill the cache, so they stay on this thread
+        litItems.resize(order.size());
+        for (int i = 0; i < order.size(); i++) {
+            const RenderItem& item = items[order[i].second];
+            litItems[i].mesh = &meshes.get(item.mesh, item.lod, item.params[0], item.params[1]);
+        }
+
+        LightJob job(this, viewPos, lights);
+        workers.parallelFor(SOFTWARE_LIGHT_JOBS, job);
+
+        FrameCounters& counters = frameCounters();
+        for (int j = 0; j < SOFTWARE_LIGHT_JOBS; j++) {
+            counters.vertices += lightJobs[j].counters.vertices;
+            counters.lightingEvals += lightJobs[j].counters.lightingEvals;
+        }
+
+        for (int i = 0; i < order.size(); i++) {
+            const LitItem& lit = litItems[i];
+            if (lit.indexCount == 0) continue;
+            const LightJobOutput& out = lightJobs[lit.job];
+            raster.drawIndexed(items[order[i].second].transform, &lit.mesh->positions[0],
+                               lit.mesh->vertexCount(), &out.colors[lit.firstColor],
+                               &out.indices[lit.firstIndex], lit.indexCount);
+            batchCount++;
+        }
+        clear();
+    }
+
+private:
+    typedef std::pair<unsigned int, int> SortEntry;     // (key, item index)
+
+    ArenaList<RenderItem> items;
+    ArenaList<SortEntry> order;
+    
+    // GL-matrix mode state
+    Matrix4x4 viewMatrix;
+    Affine3x4 viewAffine;      // Same view, for the 3x4 View * Model compose
+    MeshCache meshes;
+    VertexLighter lighter;                  // Serial paths
+    std::vector<Vec4> worldStream;          // Immediate mode positions
+    
+    // Software mode: where each sorted item's lighting landed
+    struct LitItem {
+        const LocalMesh* mesh;
+        int job;
+        int firstColor, firstIndex, indexCount;
+    };
+    struct LightJobOutput {
+        VertexLighter lighter;
+        std::vector<float> colors;              // Items of the job, back to back
+        std::vector<unsigned int> indices;
+        FrameCounters counters;
+    };
+    std::vector<LitItem> litItems;
+    LightJobOutput lightJobs[SOFTWARE_LIGHT_JOBS];
+
+    struct LightJob {
+        RenderQueue* queue;
+        const Vec4& viewPos;
+        const LightSet& lights;
+        LightJob(RenderQueue* q, const Vec4& eye, const LightSet& l) : queue(q), viewPos(eye), lights(l) {}
+        void operator()(int job) { queue->lightJob(job, viewPos, lights); }
+    };
+
+    // Light the job's run of sorted items. Counters go to this thread's
+    // frameCounters() meanwhile and are handed back through the output.
+    void lightJob(int job, const Vec4& viewPos, const LightSet& lights) {
+        LightJobOutput& out = lightJobs[job];
+        out.colors.clear();
+        out.indices.clear();
+        FrameCounters& counters = frameCounters();
+        FrameCounters saved = counters;
+        counters.reset();
+
+        int count = order.size();
+        int first = job * count / SOFTWARE_LIGHT_JOBS, last = (job + 1) * count / SOFTWARE_LIGHT_JOBS;
+        for (int i = first; i < last; i++) {
+            const RenderItem& item = items[order[i].second];
+            LitItem& lit = litItems[i];
+            out.lighter.light(*lit.mesh, item.mesh == MESH_CUBE, Affine3x4(item.transform),
+                              viewPos, lights, materials->get(item.material));
+            const std::vector<unsigned int>& visible = out.lighter.visibleIndices;
+            lit.job = job;
+            lit.firstColor = (int)out.colors.size();
+            lit.firstIndex = (int)out.indices.size();
+            lit.indexCount = (int)visible.size();
+            out.colors.insert(out.colors.end(), out.lighter.colorStream.begin(), out.lighter.colorStream.end());
+            out.indices.insert(out.indices.end(), visible.begin(), visible.end());
+        }
+
+        out.counters = counters;
+        counters = saved;
+    }
+
+    // View * Model for glLoadMatrixf (both affine: 36 multiplies, not 64)
+    Matrix4x4 modelView(const Matrix4x4& model) const {
+        return (viewAffine * Affine3x4(model)).toMatrix4x4();
+    }
+    
+    // One draw per item: View * Model on the GL stack, cached local mesh
+    void flushWithGLMatrices(const Vec4& viewPos, const LightSet& lights) {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        
+        for (int i = 0; i < order.size(); i++) {
+            const RenderItem& item = items[order[i].second];
+            const LocalMesh& mesh = meshes.get(item.mesh, item.lod, item.params[0], item.params[1]);
+            
+            lighter.light(mesh, item.mesh == MESH_CUBE, Affine3x4(item.transform),
+                          viewPos, lights, materials->get(item.material));
+            const std::vector<unsigned int>& visible = lighter.visibleIndices;
+            if (visible.empty()) continue;
+            
+            glLoadMatrixf(modelView(item.transform).ptr());
+            glVertexPointer(3, GL_FLOAT, sizeof(Vec4), &mesh.positions[0].x);
+            glColorPointer(3, GL_FLOAT, 0, &lighter.colorStream[0]);
+            glDrawElements(GL_TRIANGLES, (GLsizei)visible.size(), GL_UNSIGNED_INT, &visible[0]);
+            batchCount++;
+        }
+        
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glLoadMatrixf(viewMatrix.ptr());
+    }
+    
+    // Lighting in the shader: per item only the matrices change, and the
+    // material uniforms when the (sorted) material changes
+    void flushWithShader(const Vec4& viewPos, const LightSet& lights) {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        shader->begin(lights, viewPos);
+        
+        int boundMaterial = -1;
+        for (int i = 0; i < order.size(); i++) {
+            const RenderItem& item = items[order[i].second];
+            const LocalMesh& mesh = meshes.get(item.mesh, item.lod, item.params[0], item.params[1]);
+            
+            Vec4 localEye = Affine3x4(item.transform).inverse().transformPoint(viewPos);
+            lighter.selectFaces(mesh, item.mesh == MESH_CUBE, localEye);
+            const std::vector<unsigned int>& visible = lighter.visibleIndices;
+            if (visible.empty()) continue;
+            
+            if (item.material != boundMaterial) {
+                shader->setMaterial(materials->get(item.material));
+                boundMaterial = item.material;
+            }
+            shader->setModel(item.transform);
+            shader->setLightsAt(Vec4(item.transform.m[3][0], item.transform.m[3][1], item.transform.m[3][2]));
+            glLoadMatrixf(modelView(item.transform).ptr());
+            glVertexPointer(3, GL_FLOAT, sizeof(Vec4), &mesh.positions[0].x);
+            glNormalPointer(GL_FLOAT, sizeof(Vec4), &mesh.normals[0].x);
+            glDrawElements(GL_TRIANGLES, (GLsizei)visible.size(), GL_UNSIGNED_INT, &visible[0]);
+            countVertices(item.mesh == MESH_CUBE ? (unsigned int)visible.size() / 6 * 4
+                                                 : (unsigned int)mesh.vertexCount());
+            batchCount++;
+        }
+        
+        shader->end();
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        glLoadMatrixf(viewMatrix.ptr());
+    }
+    
+    static unsigned int sortKey(const RenderItem& item) {
+        return ((unsigned int)item.material << 16) | (item.mesh << 8) | item.lod;
+    }
+
+    // Light one item's cached mesh and emit its kept triangles in world
+    // space (inside glBegin(GL_TRIANGLES))
+    void emitCached(const RenderItem& item, const Vec4& viewPos, const LightSet& lights) {
+        const LocalMesh& mesh = meshes.get(item.mesh, item.lod, item.params[0], item.params[1]);
+        Affine3x4 A(item.transform);
+        lighter.light(mesh, item.mesh == MESH_CUBE, A, viewPos, lights, materials->get(item.material));
+
+        worldStream.resize(mesh.vertexCount());
+        for (int v = 0; v < mesh.vertexCount(); v++) worldStream[v] = A.transformPoint(mesh.positions[v]);
+        const std::vector<unsigned int>& visible = lighter.visibleIndices;
+        for (size_t k = 0; k < visible.size(); k++) {
+            unsigned int v = visible[k];
+            glColor3fv(&lighter.colorStream[3 * v]);
+            glVertex3f(worldStream[v].x, worldStream[v].y, worldStream[v].z);
+        }
+    }
+};
+
+#endif // RENDERQUEUE_H
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Input Recording / Replay Header
+ *
+ * Deterministic play sessions for performance regression runs:
+ * - Recorder logs key, mouse and warp events stamped with the sim tick
+ *   they apply to, plus the RNG seed, to a compact .smrp file
+ * - Replayer hands them back tick by tick, so the same file drives the
+ *   same game state on any build
+ ******************************************************************************/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <cstdint>
+
+// ============================================================================
+// FILE LAYOUT
+// ReplayHeader, then eventCount ReplayEvents (little-endian)
+// ============================================================================
+const char REPLAY_MAGIC[4] = {'S', 'M', 'R', 'P'};
+
+// Bumped whenever the simulation changes results, so older recordings are
+// rejected instead of desyncing (2: camera and monsters use fastSinCos)
+const uint16_t REPLAY_VERSION = 2;
+
+enum ReplayEventType {
+    EVENT_KEY_DOWN = 1,
+    EVENT_KEY_UP = 2,
+    EVENT_MOUSE_MOVE = 3,
+    EVENT_MOUSE_WARP = 4,   // Pointer was warped to the window center
+    EVENT_END = 5           // Session ended at this tick
+};
+
+struct ReplayHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t tickRate;      // Sim ticks per second
+    uint32_t seed;          // Game RNG seed
+    uint32_t eventCount;
+};
+
+struct ReplayEvent {
+    uint32_t tick;          // Sim tick the event is applied before
+    uint16_t type;
+    uint16_t key;
+    int16_t x, y;           // Mouse position (EVENT_MOUSE_MOVE)
+};
+
+// ============================================================================
+// RECORDER
+// ============================================================================
+class InputRecorder {
+public:
+    InputRecorder() : file(NULL), count(0), lastTick(0) {
+        memset(&header, 0, sizeof(header));
+    }
+
+    // Sessions not closed explicitly end at the last recorded tick
+    ~InputRecorder() { close(lastTick); }
+
+    bool isRecording() const { return file != NULL; }
+
+    bool open(const char* path, uint32_t seed, int tickRate) {
+        file = fopen(path, "wb");
+        if (!file) {
+            printf("Cannot record to '%s'\n", path);
+            return false;
+        }
+        memcpy(header.magic, REPLAY_MAGIC, 4);
+        header.version = REPLAY_VERSION;
+        header.tickRate = (uint16_t)tickRate;
+        header.seed = seed;
+        header.eventCount = 0;
+        count = 0;
+        fwrite(&header, sizeof(header), 1, file);
+        return true;
+    }
+
+    void record(uint32_t tick, int type, int key, int x, int y) {
+        if (!file) return;
+        ReplayEvent e;
+        e.tick = tick;
+        e.type = (uint16_t)type;
+        e.key = (uint16_t)key;
+        e.x = (int16_t)x;
+        e.y = (int16_t)y;
+        fwrite(&e, sizeof(e), 1, file);
+        count++;
+        lastTick = tick;
+    }
+
+    // Write the end marker and patch the event count
+    void close(uint32_t endTick) {
+        if (!file) return;
+        record(endTick, EVENT_END, 0, 0, 0);
+        header.eventCount = count;
+        fseek(file, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, file);
+        fclose(file);
+        file = NULL;
+        printf("Recorded %u input events over %u ticks\n", count, endTick);
+    }
+
+private:
+    FILE* file;
+    ReplayHeader header;
+    uint32_t count;
+    uint32_t lastTick;
+};
+
+// ============================================================================
+// REPLAYER
+// ============================================================================
+class InputReplayer {
+public:
+    ReplayHeader header;
+
+    InputReplayer() : cursor(0), active(false) {
+        memset(&header, 0, sizeof(header));
+    }
+
+    bool isActive() const { return active; }
+
+    bool load(const char* path) {
+        FILE* f = fopen(path, "rb");
+        if (!f) {
+            printf("Cannot open replay '%s'\n", path);
+            return false;
+        }
+        bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+                  memcmp(header.magic, REPLAY_MAGIC, 4) == 0;
+        if (ok && header.version != REPLAY_VERSION) {
+            printf("Replay '%s' is version %u, this build plays version %u\n",
+                   path, header.version, REPLAY_VERSION);
+            fclose(f);
+            return false;
+        }
+        if (ok) {
+            events.resize(header.eventCount);
+            ok = header.eventCount == 0 ||
+                 fread(&events[0], sizeof(ReplayEvent), header.eventCount, f) == header.eventCount;
+        }
+        fclose(f);
+        if (!ok) {
+            printf("Invalid replay '%s'\n", path);
+            return false;
+        }
+        cursor = 0;
+        active = true;
+        return true;
+    }
+
+    // Next event for this tick, or NULL once the tick's events are used up
+    const ReplayEvent* next(uint32_t tick) {
+        if (cursor >= events.size() || events[cursor].tick > tick) return NULL;
+        return &events[cursor++];
+    }
+
+    // True if every event has been handed out (a file without an end marker)
+    bool isExhausted() const { return cursor >= events.size(); }
+
+    void stop() { active = false; }
+
+private:
+    std::vector<ReplayEvent> events;
+    size_t cursor;
+    bool active;
+};
+
+#endif // REPLAY_H
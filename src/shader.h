@@ -0,0 +1,571 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Shader Header
+ *
+ * Per-pixel version of the lighting model in lighting.h (GLSL 1.20):
+ * - Same ambient + Lambert + Phong terms and the same attenuation as
+ *   calculateLighting, evaluated per fragment in world space
+ * - Light and Material are uniforms; the model matrix and its normal
+ *   matrix are uploaded per object from the Matrix4x4 helpers
+ * - Grid lights (lightgrid.h) add their direct light from a per-object
+ *   list of up to LIGHTS_PER_CELL lights, taken from the object's cell;
+ *   the primary light's direct term is dropped in shadowed cells
+ * - Reproduces the fixed-function GL_EXP fog the scene uses, since a
+ *   fragment shader replaces it
+ * - Instanced variant: one glDrawElementsInstanced per batch, with the
+ *   model and normal matrices, grid light ids and primary-light
+ *   visibility of each instance in per-instance attributes (divisor 1)
+ *   and the frame's grid lights in a uniform table of at most
+ *   MAX_TABLE_LIGHTS. Needs GL 3.3 or ARB_instanced_arrays.
+ * GL 2.0 entry points are fetched at runtime, so the game still starts
+ * (CPU lighting only) on contexts without shader support.
+ ******************************************************************************/
+
+#ifndef SHADER_H
+#define SHADER_H
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glut.h>
+#include <GL/freeglut_ext.h>
+
+#include "matrix.h"
+#include "lighting.h"
+#include "lightgrid.h"
+#include "instancing.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// ============================================================================
+// GLSL SOURCES
+// ============================================================================
+// Sources follow a generated "#version 120" + MAX_LOCAL_LIGHTS and
+// MAX_TABLE_LIGHTS header; fragment shaders also follow PHONG_LIGHTING_SOURCE
+const char* const PHONG_VERTEX_SHADER =
+    "uniform mat4 modelMatrix;\n"
+    "uniform mat3 normalMatrix;\n"
+    "varying vec3 worldPosition;\n"
+    "varying vec3 worldNormal;\n"
+    "void main() {\n"
+    "    worldPosition = (modelMatrix * gl_Vertex).xyz;\n"
+    "    worldNormal = normalMatrix * gl_Normal;\n"
+    "    vec4 eye = gl_ModelViewMatrix * gl_Vertex;\n"
+    "    gl_FogFragCoord = abs(eye.z);\n"
+    "    gl_Position = gl_ProjectionMatrix * eye;\n"
+    "}\n";
+
+// Declarations and helpers both fragment shaders start with
+const char* const PHONG_LIGHTING_SOURCE =
+    "uniform vec3 lightPosition;\n"
+    "uniform vec3 lightAmbient;\n"
+    "uniform vec3 lightDiffuse;\n"
+    "uniform vec3 lightSpecular;\n"
+    "uniform vec3 lightAttenuation;\n"      // constant, linear, quadratic
+    "uniform vec3 viewPosition;\n"
+    "uniform vec3 materialAmbient;\n"
+    "uniform vec3 materialDiffuse;\n"
+    "uniform vec3 materialSpecular;\n"
+    "uniform float materialShininess;\n"
+    "varying vec3 worldPosition;\n"
+    "varying vec3 worldNormal;\n"
+    "vec3 directLight(vec3 N, vec3 V, vec3 position, vec3 diffuse, vec3 specular, vec3 att) {\n"
+    "    vec3 L = position - worldPosition;\n"
+    "    float distance = length(L);\n"
+    "    L /= distance;\n"
+    "    float diff = max(0.0, dot(N, L));\n"
+    "    vec3 R = normalize(N * (2.0 * dot(N, L)) - L);\n"
+    "    float spec = pow(max(0.0, dot(V, R)), materialShininess);\n"
+    "    float attenuation = 1.0 / (att.x + att.y * distance + att.z * distance * distance);\n"
+    "    return min(diffuse * materialDiffuse * diff + specular * materialSpecular * spec, vec3(1.0))\n"
+    "           * attenuation;\n"
+    "}\n"
+    "vec4 foggedColor(vec3 color) {\n"
+    "    float fog = clamp(exp(-gl_Fog.density * gl_FogFragCoord), 0.0, 1.0);\n"
+    "    return vec4(mix(gl_Fog.color.rgb, clamp(color, 0.0, 1.0), fog), 1.0);\n"
+    "}\n";
+
+const char* const PHONG_FRAGMENT_SHADER =
+    "uniform float lightVisible;\n"         // 0 in cells the light cannot see
+    "uniform int localLightCount;\n"
+    "uniform vec3 localLightPosition[MAX_LOCAL_LIGHTS];\n"
+    "uniform vec3 localLightDiffuse[MAX_LOCAL_LIGHTS];\n"
+    "uniform vec3 localLightSpecular[MAX_LOCAL_LIGHTS];\n"
+    "uniform vec3 localLightAttenuation[MAX_LOCAL_LIGHTS];\n"
+    "void main() {\n"
+    "    vec3 N = normalize(worldNormal);\n"
+    "    vec3 V = normalize(viewPosition - worldPosition);\n"
+    "    vec3 color = lightAmbient * materialAmbient;\n"
+    "    if (lightVisible > 0.0) {\n"
+    "        color += directLight(N, V, lightPosition, lightDiffuse, lightSpecular, lightAttenuation);\n"
+    "    }\n"
+    "    for (int i = 0; i < MAX_LOCAL_LIGHTS; i++) {\n"
+    "        if (i >= localLightCount) break;\n"
+    "        color += directLight(N, V, localLightPosition[i], localLightDiffuse[i],\n"
+    "                             localLightSpecular[i], localLightAttenuation[i]);\n"
+    "    }\n"
+    "    gl_FragColor = foggedColor(color);\n"
+    "}\n";
+
+// GL_MODELVIEW holds the view only; the model matrix comes per instance
+const char* const INSTANCED_VERTEX_SHADER =
+    "attribute mat4 instanceModel;\n"
+    "attribute mat3 instanceNormal;\n"
+    "attribute vec4 instanceLights0;\n"     // Table indices, -1 = none
+    "attribute vec4 instanceLights1;\n"
+    "attribute float instanceVisible;\n"
+    "varying vec3 worldPosition;\n"
+    "varying vec3 worldNormal;\n"
+    "varying vec4 lightIds0;\n"
+    "varying vec4 lightIds1;\n"
+    "varying float lightVisible;\n"
+    "void main() {\n"
+    "    vec4 world = instanceModel * gl_Vertex;\n"
+    "    worldPosition = world.xyz;\n"
+    "    worldNormal = instanceNormal * gl_Normal;\n"
+    "    lightIds0 = instanceLights0;\n"
+    "    lightIds1 = instanceLights1;\n"
+    "    lightVisible = instanceVisible;\n"
+    "    vec4 eye = gl_ModelViewMatrix * world;\n"
+    "    gl_FogFragCoord = abs(eye.z);\n"
+    "    gl_Position = gl_ProjectionMatrix * eye;\n"
+    "}\n";
+
+const char* const INSTANCED_FRAGMENT_SHADER =
+    "uniform vec3 tableLightPosition[MAX_TABLE_LIGHTS];\n"
+    "uniform vec3 tableLightDiffuse[MAX_TABLE_LIGHTS];\n"
+    "uniform vec3 tableLightSpecular[MAX_TABLE_LIGHTS];\n"
+    "uniform vec3 tableLightAttenuation[MAX_TABLE_LIGHTS];\n"
+    "varying vec4 lightIds0;\n"
+    "varying vec4 lightIds1;\n"
+    "varying float lightVisible;\n"
+    "vec3 tableLight(vec3 N, vec3 V, float id) {\n"
+    "    if (id < -0.5) return vec3(0.0);\n"
+    "    int i = int(id + 0.5);\n"
+    "    return directLight(N, V, tableLightPosition[i], tableLightDiffuse[i],\n"
+    "                       tableLightSpecular[i], tableLightAttenuation[i]);\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 N = normalize(worldNormal);\n"
+    "    vec3 V = normalize(viewPosition - worldPosition);\n"
+    "    vec3 color = lightAmbient * materialAmbient;\n"
+    "    if (lightVisible > 0.5) {\n"
+    "        color += directLight(N, V, lightPosition, lightDiffuse, lightSpecular, lightAttenuation);\n"
+    "    }\n"
+    "    for (int k = 0; k < 4; k++) {\n"
+    "        color += tableLight(N, V, lightIds0[k]) + tableLight(N, V, lightIds1[k]);\n"
+    "    }\n"
+    "    gl_FragColor = foggedColor(color);\n"
+    "}\n";
+
+// ============================================================================
+// GL 2.0 ENTRY POINTS
+// ============================================================================
+struct ShaderApi {
+    PFNGLCREATESHADERPROC createShader;
+    PFNGLSHADERSOURCEPROC shaderSource;
+    PFNGLCOMPILESHADERPROC compileShader;
+    PFNGLGETSHADERIVPROC getShaderiv;
+    PFNGLGETSHADERINFOLOGPROC getShaderInfoLog;
+    PFNGLDELETESHADERPROC deleteShader;
+    PFNGLCREATEPROGRAMPROC createProgram;
+    PFNGLATTACHSHADERPROC attachShader;
+    PFNGLLINKPROGRAMPROC linkProgram;
+    PFNGLGETPROGRAMIVPROC getProgramiv;
+    PFNGLGETPROGRAMINFOLOGPROC getProgramInfoLog;
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+    PFNGLUNIFORM1IPROC uniform1i;
+    PFNGLUNIFORM1FPROC uniform1f;
+    PFNGLUNIFORM3FPROC uniform3f;
+    PFNGLUNIFORM3FVPROC uniform3fv;
+    PFNGLUNIFORMMATRIX3FVPROC uniformMatrix3fv;
+    PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv;
+    PFNGLBINDATTRIBLOCATIONPROC bindAttribLocation;
+    PFNGLVERTEXATTRIBPOINTERPROC vertexAttribPointer;
+    PFNGLENABLEVERTEXATTRIBARRAYPROC enableVertexAttribArray;
+    PFNGLDISABLEVERTEXATTRIBARRAYPROC disableVertexAttribArray;
+
+    // Instancing (GL 3.3, or the ARB extensions)
+    PFNGLVERTEXATTRIBDIVISORPROC vertexAttribDivisor;
+    PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+
+    // Fetch everything; false if any entry point is missing
+    bool load() {
+        return get(createShader, "glCreateShader") && get(shaderSource, "glShaderSource") &&
+               get(compileShader, "glCompileShader") && get(getShaderiv, "glGetShaderiv") &&
+               get(getShaderInfoLog, "glGetShaderInfoLog") && get(deleteShader, "glDeleteShader") &&
+               get(createProgram, "glCreateProgram") && get(attachShader, "glAttachShader") &&
+               get(linkProgram, "glLinkProgram") && get(getProgramiv, "glGetProgramiv") &&
+               get(getProgramInfoLog, "glGetProgramInfoLog") && get(useProgram, "glUseProgram") &&
+               get(getUniformLocation, "glGetUniformLocation") && get(uniform1i, "glUniform1i") &&
+               get(uniform1f, "glUniform1f") && get(uniform3f, "glUniform3f") &&
+               get(uniform3fv, "glUniform3fv") && get(uniformMatrix3fv, "glUniformMatrix3fv") &&
+               get(uniformMatrix4fv, "glUniformMatrix4fv") &&
+               get(bindAttribLocation, "glBindAttribLocation") &&
+               get(vertexAttribPointer, "glVertexAttribPointer") &&
+               get(enableVertexAttribArray, "glEnableVertexAttribArray") &&
+               get(disableVertexAttribArray, "glDisableVertexAttribArray");
+    }
+
+    // Instancing entry points after load(); false if the context has
+    // neither GL 3.3 nor GL_ARB_instanced_arrays + GL_ARB_draw_instanced
+    // (GLX hands out pointers for anything, so the version decides)
+    bool loadInstancing() {
+        int major = 0, minor = 0;
+        const char* version = (const char*)glGetString(GL_VERSION);
+        if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return false;
+        if (major > 3 || (major == 3 && minor >= 3)) {
+            return get(vertexAttribDivisor, "glVertexAttribDivisor") &&
+                   get(drawElementsInstanced, "glDrawElementsInstanced");
+        }
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "GL_ARB_instanced_arrays") ||
+            !strstr(extensions, "GL_ARB_draw_instanced")) {
+            return false;
+        }
+        return get(vertexAttribDivisor, "glVertexAttribDivisorARB") &&
+               get(drawElementsInstanced, "glDrawElementsInstancedARB");
+    }
+
+private:
+    template <typename Proc>
+    static bool get(Proc& proc, const char* name) {
+        proc = (Proc)glutGetProcAddress(name);
+        return proc != NULL;
+    }
+};
+
+// ============================================================================
+// INSTANCE ATTRIBUTES
+// Generic attribute locations start at 4, clear of the slots some drivers
+// alias to gl_Vertex (0), gl_Normal (2) and gl_Color (3).
+// ============================================================================
+const int MAX_TABLE_LIGHTS = 32;        // Grid lights the instanced program can index
+
+const GLuint INSTANCE_ATTRIB_MODEL = 4;     // mat4: 4 slots
+const GLuint INSTANCE_ATTRIB_NORMAL = 8;    // mat3: 3 slots
+const GLuint INSTANCE_ATTRIB_LIGHTS = 11;   // 2 x vec4
+const GLuint INSTANCE_ATTRIB_VISIBLE = 13;
+const GLuint INSTANCE_ATTRIB_END = 14;
+
+// One instance as the instanced program reads it (LIGHTS_PER_CELL ids fill
+// instanceLights0/1)
+struct InstanceAttributes {
+    float model[16];                    // Column-major
+    float normal[9];                    // Normal matrix, 3 columns
+    float lights[LIGHTS_PER_CELL];      // Grid light indices, -1 = none
+    float visible;                      // 1 if the primary light reaches the instance
+};
+
+// Matrices of one instance, plus the grid lights and primary-light
+// visibility of its cell, picked as PhongShader::setLightsAt picks them
+inline void packInstance(const Matrix4x4& model, const LightSet& lights, InstanceAttributes& out) {
+    memcpy(out.model, model.ptr(), sizeof(out.model));
+    Affine3x4 N = Affine3x4(model).normalMatrix();
+    memcpy(out.normal, &N.m[0][0], sizeof(out.normal));
+
+    Vec4 centre(model.m[3][0], model.m[3][1], model.m[3][2]);
+    out.visible = !lights.shadow || lights.shadow->isLitAt(centre) ? 1.0f : 0.0f;
+    int count = 0;
+    const unsigned short* ids = lights.grid ? lights.grid->lightsAt(centre, count) : NULL;
+    for (int i = 0; i < LIGHTS_PER_CELL; i++) out.lights[i] = i < count ? (float)ids[i] : -1.0f;
+}
+
+// ============================================================================
+// PHONG SHADER
+// ============================================================================
+class PhongShader {
+public:
+    PhongShader() : program(0), instancedProgram(0), failed(false), active(&perObject),
+                    grid(NULL), shadow(NULL), boundCell(-1) {}
+
+    bool isReady() const { return program != 0; }
+    bool canInstance() const { return instancedProgram != 0; }
+
+    // Compile and link once a GL context exists; false (with the reason on
+    // stderr) if shaders are unsupported. A failure is not retried. The
+    // instanced program is optional: without it, canInstance() is false.
+    bool init() {
+        if (program) return true;
+        if (failed) return false;
+        failed = true;
+
+        const char* version = (const char*)glGetString(GL_VERSION);
+        if (!version || version[0] < '2' || !gl.load()) {
+            fprintf(stderr, "Shaders unavailable: OpenGL 2.0 required (have %s)\n",
+                    version ? version : "none");
+            return false;
+        }
+
+        GLuint prog = link(PHONG_VERTEX_SHADER, PHONG_FRAGMENT_SHADER, false);
+        if (!prog) return false;
+
+        program = prog;
+        failed = false;
+        perObject.locate(gl, program);
+        uModel = gl.getUniformLocation(program, "modelMatrix");
+        uNormal = gl.getUniformLocation(program, "normalMatrix");
+        uLightVisible = gl.getUniformLocation(program, "lightVisible");
+        uLocalCount = gl.getUniformLocation(program, "localLightCount");
+        uLocalPosition = gl.getUniformLocation(program, "localLightPosition");
+        uLocalDiffuse = gl.getUniformLocation(program, "localLightDiffuse");
+        uLocalSpecular = gl.getUniformLocation(program, "localLightSpecular");
+        uLocalAttenuation = gl.getUniformLocation(program, "localLightAttenuation");
+
+        if (!gl.loadInstancing()) {
+            fprintf(stderr, "Instanced shader unavailable: OpenGL 3.3 or GL_ARB_instanced_arrays required\n");
+            return true;
+        }
+        instancedProgram = link(INSTANCED_VERTEX_SHADER, INSTANCED_FRAGMENT_SHADER, true);
+        if (!instancedProgram) return true;
+        instanced.locate(gl, instancedProgram);
+        uTablePosition = gl.getUniformLocation(instancedProgram, "tableLightPosition");
+        uTableDiffuse = gl.getUniformLocation(instancedProgram, "tableLightDiffuse");
+        uTableSpecular = gl.getUniformLocation(instancedProgram, "tableLightSpecular");
+        uTableAttenuation = gl.getUniformLocation(instancedProgram, "tableLightAttenuation");
+        return true;
+    }
+
+    // Bind the program and upload the per-frame primary light and eye
+    void begin(const LightSet& lights, const Vec4& viewPos) {
+        gl.useProgram(program);
+        active = &perObject;
+        grid = lights.grid;
+        shadow = lights.shadow;
+        boundCell = -1;
+        gl.uniform1i(uLocalCount, 0);
+        gl.uniform1f(uLightVisible, 1.0f);
+        setFrame(*lights.primary, viewPos);
+    }
+
+    void setMaterial(const Material& material) {
+        setColor(active->materialAmbient, material.ambient, 1.0f);
+        setColor(active->materialDiffuse, material.diffuse, 1.0f);
+        setColor(active->materialSpecular, material.specular, 1.0f);
+        gl.uniform1f(active->materialShininess, material.shininess);
+    }
+
+    // Model matrix for lighting; GL_MODELVIEW must hold View * model
+    void setModel(const Matrix4x4& model) {
+        gl.uniformMatrix4fv(uModel, 1, GL_FALSE, model.ptr());
+        Affine3x4 N = Affine3x4(model).normalMatrix();
+        gl.uniformMatrix3fv(uNormal, 1, GL_FALSE, &N.m[0][0]);   // First 3 columns
+    }
+
+    // Grid lights and primary-light visibility of the cell containing p,
+    // for the objects drawn next
+    void setLightsAt(const Vec4& p) {
+        if (shadow) gl.uniform1f(uLightVisible, shadow->isLitAt(p) ? 1.0f : 0.0f);
+        if (!grid) return;
+        int cell = grid->cellAt(p);
+        if (cell == boundCell) return;
+        boundCell = cell;
+
+        int count;
+        const unsigned short* ids = grid->lightsAt(p, count);
+        float position[LIGHTS_PER_CELL * 3], diffuse[LIGHTS_PER_CELL * 3];
+        float specular[LIGHTS_PER_CELL * 3], attenuation[LIGHTS_PER_CELL * 3];
+        for (int i = 0; i < count; i++) {
+            packLight(grid->light(ids[i]), i, position, diffuse, specular, attenuation);
+        }
+        gl.uniform1i(uLocalCount, count);
+        if (count == 0) return;
+        gl.uniform3fv(uLocalPosition, count, position);
+        gl.uniform3fv(uLocalDiffuse, count, diffuse);
+        gl.uniform3fv(uLocalSpecular, count, specular);
+        gl.uniform3fv(uLocalAttenuation, count, attenuation);
+    }
+
+    // Bind the instanced program for the frame: primary light, eye and the
+    // grid's lights as the table instances index. GL_MODELVIEW must hold
+    // the view. False (nothing bound) without the program or when the grid
+    // has more than MAX_TABLE_LIGHTS lights.
+    bool beginInstanced(const LightSet& lights, const Vec4& viewPos) {
+        if (!instancedProgram) return false;
+        int count = lights.grid ? lights.grid->lightCount() : 0;
+        if (count > MAX_TABLE_LIGHTS) return false;
+
+        gl.useProgram(instancedProgram);
+        active = &instanced;
+        setFrame(*lights.primary, viewPos);
+        if (count == 0) return true;
+
+        float position[MAX_TABLE_LIGHTS * 3], diffuse[MAX_TABLE_LIGHTS * 3];
+        float specular[MAX_TABLE_LIGHTS * 3], attenuation[MAX_TABLE_LIGHTS * 3];
+        for (int i = 0; i < count; i++) {
+            packLight(lights.grid->light(i), i, position, diffuse, specular, attenuation);
+        }
+        gl.uniform3fv(uTablePosition, count, position);
+        gl.uniform3fv(uTableDiffuse, count, diffuse);
+        gl.uniform3fv(uTableSpecular, count, specular);
+        gl.uniform3fv(uTableAttenuation, count, attenuation);
+        return true;
+    }
+
+    // Draw count copies of mesh with one call; after beginInstanced()
+    void drawInstanced(const LocalMesh& mesh, const InstanceAttributes* instances, int count) {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glVertexPointer(3, GL_FLOAT, sizeof(Vec4), &mesh.positions[0].x);
+        glNormalPointer(GL_FLOAT, sizeof(Vec4), &mesh.normals[0].x);
+        for (int c = 0; c < 4; c++) instanceAttribute(INSTANCE_ATTRIB_MODEL + c, 4, instances->model + 4 * c);
+        for (int c = 0; c < 3; c++) instanceAttribute(INSTANCE_ATTRIB_NORMAL + c, 3, instances->normal + 3 * c);
+        instanceAttribute(INSTANCE_ATTRIB_LIGHTS, 4, instances->lights);
+        instanceAttribute(INSTANCE_ATTRIB_LIGHTS + 1, 4, instances->lights + 4);
+        instanceAttribute(INSTANCE_ATTRIB_VISIBLE, 1, &instances->visible);
+
+        gl.drawElementsInstanced(GL_TRIANGLES, (GLsizei)mesh.indexCount(), GL_UNSIGNED_INT,
+                                 &mesh.indices[0], count);
+
+        for (GLuint a = INSTANCE_ATTRIB_MODEL; a < INSTANCE_ATTRIB_END; a++) {
+            gl.vertexAttribDivisor(a, 0);
+            gl.disableVertexAttribArray(a);
+        }
+        glDisableClientState(GL_NORMAL_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+    void end() { gl.useProgram(0); }
+
+private:
+    // Uniforms both programs have
+    struct FrameUniforms {
+        GLint lightPosition, lightAmbient, lightDiffuse, lightSpecular, lightAttenuation;
+        GLint viewPosition;
+        GLint materialAmbient, materialDiffuse, materialSpecular, materialShininess;
+
+        void locate(ShaderApi& gl, GLuint program) {
+            lightPosition = gl.getUniformLocation(program, "lightPosition");
+            lightAmbient = gl.getUniformLocation(program, "lightAmbient");
+            lightDiffuse = gl.getUniformLocation(program, "lightDiffuse");
+            lightSpecular = gl.getUniformLocation(program, "lightSpecular");
+            lightAttenuation = gl.getUniformLocation(program, "lightAttenuation");
+            viewPosition = gl.getUniformLocation(program, "viewPosition");
+            materialAmbient = gl.getUniformLocation(program, "materialAmbient");
+            materialDiffuse = gl.getUniformLocation(program, "materialDiffuse");
+            materialSpecular = gl.getUniformLocation(program, "materialSpecular");
+            materialShininess = gl.getUniformLocation(program, "materialShininess");
+        }
+    };
+
+    ShaderApi gl;
+    GLuint program, instancedProgram;
+    bool failed;
+    FrameUniforms perObject, instanced;
+    FrameUniforms* active;              // Of the program bound last
+    GLint uModel, uNormal;
+    GLint uLightVisible;
+    GLint uLocalCount, uLocalPosition, uLocalDiffuse, uLocalSpecular, uLocalAttenuation;
+    GLint uTablePosition, uTableDiffuse, uTableSpecular, uTableAttenuation;
+
+    // Lights of the current begin() and the cell whose grid lights are uploaded
+    const LightGrid* grid;
+    const ShadowMask* shadow;
+    int boundCell;
+
+    static void setVec3(float* out, float x, float y, float z) {
+        out[0] = x; out[1] = y; out[2] = z;
+    }
+
+    static void packLight(const Light& l, int i, float* position, float* diffuse,
+                          float* specular, float* attenuation) {
+        setVec3(position + 3 * i, l.position.x, l.position.y, l.position.z);
+        setVec3(diffuse + 3 * i, l.diffuse.r, l.diffuse.g, l.diffuse.b);
+        setVec3(specular + 3 * i, l.specular.r, l.specular.g, l.specular.b);
+        setVec3(attenuation + 3 * i, l.constantAtt, l.linearAtt, l.quadraticAtt);
+    }
+
+    void setColor(GLint location, const Color& c, float scale) {
+        gl.uniform3f(location, c.r * scale, c.g * scale, c.b * scale);
+    }
+
+    // Primary light and eye into the active program
+    void setFrame(const Light& light, const Vec4& viewPos) {
+        // A disabled light lights nothing, like calculateLighting
+        float on = light.isEnabled ? 1.0f : 0.0f;
+        gl.uniform3f(active->lightPosition, light.position.x, light.position.y, light.position.z);
+        setColor(active->lightAmbient, light.ambient, on);
+        setColor(active->lightDiffuse, light.diffuse, on);
+        setColor(active->lightSpecular, light.specular, on);
+        gl.uniform3f(active->lightAttenuation, light.constantAtt, light.linearAtt, light.quadraticAtt);
+        gl.uniform3f(active->viewPosition, viewPos.x, viewPos.y, viewPos.z);
+    }
+
+    void instanceAttribute(GLuint location, GLint size, const float* first) {
+        gl.vertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(InstanceAttributes), first);
+        gl.vertexAttribDivisor(location, 1);
+        gl.enableVertexAttribArray(location);
+    }
+
+    // Program from a vertex and a fragment shader; 0 (log on stderr) on failure
+    GLuint link(const char* vertexSource, const char* fragmentSource, bool instancedAttributes) {
+        GLuint vs = compile(GL_VERTEX_SHADER, vertexSource, NULL);
+        GLuint fs = compile(GL_FRAGMENT_SHADER, PHONG_LIGHTING_SOURCE, fragmentSource);
+        if (!vs || !fs) {
+            if (vs) gl.deleteShader(vs);
+            if (fs) gl.deleteShader(fs);
+            return 0;
+        }
+
+        GLuint prog = gl.createProgram();
+        gl.attachShader(prog, vs);
+        gl.attachShader(prog, fs);
+        if (instancedAttributes) {
+            gl.bindAttribLocation(prog, INSTANCE_ATTRIB_MODEL, "instanceModel");
+            gl.bindAttribLocation(prog, INSTANCE_ATTRIB_NORMAL, "instanceNormal");
+            gl.bindAttribLocation(prog, INSTANCE_ATTRIB_LIGHTS, "instanceLights0");
+            gl.bindAttribLocation(prog, INSTANCE_ATTRIB_LIGHTS + 1, "instanceLights1");
+            gl.bindAttribLocation(prog, INSTANCE_ATTRIB_VISIBLE, "instanceVisible");
+        }
+        gl.linkProgram(prog);
+        gl.deleteShader(vs);        // Freed with the program
+        gl.deleteShader(fs);
+
+        GLint linked = 0;
+        gl.getProgramiv(prog, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            printLog(prog, false);
+            return 0;
+        }
+        return prog;
+    }
+
+    // Header, then one or two source strings
+    GLuint compile(GLenum type, const char* source, const char* more) {
+        char header[128];
+        snprintf(header, sizeof(header), "#version 120\n#define MAX_LOCAL_LIGHTS %d\n#define MAX_TABLE_LIGHTS %d\n",
+                 LIGHTS_PER_CELL, MAX_TABLE_LIGHTS);
+        const char* sources[3] = {header, source, more};
+
+        GLuint shader = gl.createShader(type);
+        gl.shaderSource(shader, more ? 3 : 2, sources, NULL);
+        gl.compileShader(shader);
+
+        GLint compiled = 0;
+        gl.getShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            printLog(shader, true);
+            gl.deleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    void printLog(GLuint object, bool isShader) {
+        GLint length = 0;
+        if (isShader) gl.getShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+        else gl.getProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+
+        std::vector<char> log(length > 1 ? length : 1, '\0');
+        if (isShader) gl.getShaderInfoLog(object, (GLsizei)log.size(), NULL, &log[0]);
+        else gl.getProgramInfoLog(object, (GLsizei)log.size(), NULL, &log[0]);
+        fprintf(stderr, "Shader %s failed:\n%s\n", isShader ? "compile" : "link", &log[0]);
+    }
+};
+
+#endif // SHADER_H
@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Shadowcasting Header
+ *
+ * Which maze cells a point light can see, at cell granularity:
+ * - Recursive shadowcasting over the wall grid, one pass per octant,
+ *   from the light's cell out to the light's range
+ * - Walls the light sees are lit (their faces towards it get light); open
+ *   cells are lit when the light sees them
+ * - Recomputed only when the light enters another cell or the maze changes
+ * Points in unlit cells get the ambient term only and skip Phong.
+ ******************************************************************************/
+
+#ifndef SHADOWCAST_H
+#define SHADOWCAST_H
+
+#include "matrix.h"
+#include "bitgrid.h"
+
+#include <vector>
+#include <cmath>
+
+// Octant transforms: (col, row) -> (dx, dz)
+const int SHADOW_OCTANTS[4][8] = {
+    {1, 0, 0, -1, -1, 0, 0, 1},
+    {0, 1, -1, 0, 0, -1, 1, 0},
+    {0, 1, 1, 0, 0, -1, -1, 0},
+    {1, 0, 0, 1, -1, 0, 0, -1}
+};
+
+class ShadowMask {
+public:
+    ShadowMask() : width(0), height(0), cellSize(1.0f), lightX(-1), lightZ(-1),
+                   litCells(0), stale(true) {}
+
+    int litCount() const { return litCells; }
+
+    // Force a recompute on the next update (walls changed)
+    void invalidate() { stale = true; }
+
+    // Recompute if the light moved to another cell or the walls changed;
+    // true if the mask was recomputed
+    bool update(const BitGrid& walls, const Vec4& gridOrigin, float size,
+                const Vec4& lightPos, float range) {
+        origin = gridOrigin;
+        cellSize = size;
+        int x = cellX(lightPos.x), z = cellZ(lightPos.z);
+        if (!stale && x == lightX && z == lightZ &&
+            walls.width == width && walls.height == height) {
+            return false;
+        }
+
+        width = walls.width;
+        height = walls.height;
+        lightX = x;
+        lightZ = z;
+        stale = false;
+        lit.assign(width * height, 0);
+        litCells = 0;
+
+        int radius = (int)std::ceil(range / cellSize);
+        markLit(x, z, radius);
+        for (int oct = 0; oct < 8; oct++) {
+            castLight(walls, 1, 1.0f, 0.0f, radius,
+                      SHADOW_OCTANTS[0][oct], SHADOW_OCTANTS[1][oct],
+                      SHADOW_OCTANTS[2][oct], SHADOW_OCTANTS[3][oct]);
+        }
+        return true;
+    }
+
+    bool isLit(int x, int z) const {
+        if (x < 0 || z < 0 || x >= width || z >= height) return false;
+        return lit[z * width + x] != 0;
+    }
+
+    // Cell of a surface point: stepped slightly against the normal so a
+    // wall face at a cell border belongs to its wall
+    bool isLitAt(const Vec4& p, const Vec4& normal) const {
+        return isLit(cellX(p.x - normal.x * 0.01f), cellZ(p.z - normal.z * 0.01f));
+    }
+
+    bool isLitAt(const Vec4& p) const { return isLit(cellX(p.x), cellZ(p.z)); }
+
+    // Cell id under a world position, -1 outside
+    int cellAt(const Vec4& p) const {
+        int x = cellX(p.x), z = cellZ(p.z);
+        if (x < 0 || z < 0 || x >= width || z >= height) return -1;
+        return z * width + x;
+    }
+
+private:
+    std::vector<unsigned char> lit;     // 1 = the light sees the cell
+    int width, height;
+    Vec4 origin;
+    float cellSize;
+    int lightX, lightZ;                 // Cell the mask was cast from
+    int litCells;
+    bool stale;
+
+    int cellX(float x) const { return (int)std::floor((x - origin.x) / cellSize); }
+    int cellZ(float z) const { return (int)std::floor((z - origin.z) / cellSize); }
+
+    void markLit(int x, int z, int radius) {
+        int dx = x - lightX, dz = z - lightZ;
+        if (dx * dx + dz * dz > radius * radius) return;
+        if (x < 0 || z < 0 || x >= width || z >= height) return;
+        unsigned char& cell = lit[z * width + x];
+        if (!cell) litCells++;
+        cell = 1;
+    }
+
+    // Scan rows outward between slopes start > end; walls split the
+    // visible span and recurse for the part left of the wall
+    void castLight(const BitGrid& walls, int row, float start, float end, int radius,
+                   int xx, int xy, int yx, int yy) {
+        if (start < end) return;
+        float newStart = 0.0f;
+        for (int j = row; j <= radius; j++) {
+            bool blocked = false;
+            for (int dx = -j; dx <= 0; dx++) {
+                int dy = -j;
+                int x = lightX + dx * xx + dy * xy;
+                int z = lightZ + dx * yx + dy * yy;
+                float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+                float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+                if (start < rightSlope) continue;
+                if (end > leftSlope) break;
+
+                markLit(x, z, radius);
+                bool wall = walls.isWall(x, z);     // Outside counts as wall
+                if (blocked) {
+                    if (wall) {
+                        newStart = rightSlope;
+                        continue;
+                    }
+                    blocked = false;
+                    start = newStart;
+                } else if (wall && j < radius) {
+                    blocked = true;
+                    castLight(walls, j + 1, start, leftSlope, radius, xx, xy, yx, yy);
+                    newStart = rightSlope;
+                }
+            }
+            if (blocked) break;
+        }
+    }
+};
+
+#endif // SHADOWCAST_H
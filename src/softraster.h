@@ -0,0 +1,440 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Software Rasterizer Header
+ *
+ * CPU renderer for the same scene the GL path draws:
+ * - Framebuffer: RGBA8 colour (bottom row first, like glDrawPixels) plus
+ *   a float depth buffer; can be blitted or saved as PPM
+ * - Vertex stage (calling thread): Matrix4x4 view-projection * model,
+ *   near-plane clipping, per-vertex GL_EXP fog, viewport mapping, then
+ *   each triangle is binned into the RASTER_TILE x RASTER_TILE screen
+ *   tiles its bounds overlap
+ * - Raster stage (WorkerPool): one job per tile clears the tile and draws
+ *   its triangles with edge functions, a depth test and perspective-correct
+ *   Gouraud colour; tiles never share pixels, so no locking
+ * - Line strips are clipped to the frustum when submitted and drawn after
+ *   the tiles on the calling thread (Bresenham, depth tested, width pixels
+ *   across the minor axis like aliased GL wide lines)
+ * No GL calls: the headless benchmark can use it too.
+ ******************************************************************************/
+
+#ifndef SOFTRASTER_H
+#define SOFTRASTER_H
+
+#include "matrix.h"
+#include "lighting.h"
+#include "workers.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+const int RASTER_TILE = 64;
+
+// ============================================================================
+// FRAMEBUFFER
+// ============================================================================
+struct Framebuffer {
+    int width, height;
+    std::vector<uint32_t> color;    // RGBA8 in memory order, row 0 = bottom
+    std::vector<float> depth;       // 0 = near, 1 = far
+
+    Framebuffer() : width(0), height(0) {}
+
+    // Reallocates only when the size changes; SoftRasterizer clears each
+    // tile before drawing into it, so the contents need no clearing here
+    void resize(int w, int h) {
+        if (w == width && h == height) return;
+        width = w;
+        height = h;
+        color.assign((size_t)w * h, 0);
+        depth.assign((size_t)w * h, 1.0f);
+    }
+
+    const void* pixels() const { return color.empty() ? NULL : &color[0]; }
+
+    // Binary PPM, top row first
+    bool savePPM(const char* path) const {
+        FILE* f = fopen(path, "wb");
+        if (!f) return false;
+        fprintf(f, "P6\n%d %d\n255\n", width, height);
+        std::vector<unsigned char> row(width * 3);
+        for (int y = height - 1; y >= 0; y--) {
+            const unsigned char* src = (const unsigned char*)&color[(size_t)y * width];
+            for (int x = 0; x < width; x++) {
+                row[x * 3] = src[x * 4];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            fwrite(&row[0], 1, row.size(), f);
+        }
+        fclose(f);
+        return true;
+    }
+};
+
+inline uint32_t packColor(float r, float g, float b) {
+    unsigned char bytes[4] = {
+        (unsigned char)(std::min(1.0f, std::max(0.0f, r)) * 255.0f + 0.5f),
+        (unsigned char)(std::min(1.0f, std::max(0.0f, g)) * 255.0f + 0.5f),
+        (unsigned char)(std::min(1.0f, std::max(0.0f, b)) * 255.0f + 0.5f),
+        255
+    };
+    uint32_t packed;
+    memcpy(&packed, bytes, 4);
+    return packed;
+}
+
+// ============================================================================
+// SOFTWARE RASTERIZER
+// ============================================================================
+class SoftRasterizer {
+public:
+    // Statistics of the last frame
+    int trianglesSubmitted;
+    int trianglesBinned;        // After clipping and trivial rejection
+
+    explicit SoftRasterizer(WorkerPool* workerPool)
+        : trianglesSubmitted(0), trianglesBinned(0), pool(workerPool), target(NULL),
+          tilesX(0), tilesY(0), fogDensity(0), clearValue(0) {}
+
+    void setFog(const Color& color, float density) {
+        fogColor = color;
+        fogDensity = density;
+    }
+
+    // Start a frame; nothing is written until end()
+    void begin(Framebuffer& framebuffer, const Matrix4x4& viewProjection, const Color& clearColor) {
+        target = &framebuffer;
+        viewProj = viewProjection;
+        clearValue = packColor(clearColor.r, clearColor.g, clearColor.b);
+        tilesX = (framebuffer.width + RASTER_TILE - 1) / RASTER_TILE;
+        tilesY = (framebuffer.height + RASTER_TILE - 1) / RASTER_TILE;
+        bins.resize(tilesX * tilesY);
+        for (size_t i = 0; i < bins.size(); i++) bins[i].clear();
+        triangles.clear();
+        lines.clear();
+        trianglesSubmitted = 0;
+        trianglesBinned = 0;
+    }
+
+    // Indexed triangles in model space with one RGB colour per vertex
+    void drawIndexed(const Matrix4x4& model, const Vec4* positions, int vertexCount,
+                     const float* colors, const unsigned int* indices, int indexCount) {
+        Matrix4x4 mvp = viewProj * model;
+        clipVerts.resize(vertexCount);
+        for (int i = 0; i < vertexCount; i++) {
+            clipVerts[i] = toClip(mvp, positions[i], colors + 3 * i);
+        }
+        for (int i = 0; i + 2 < indexCount; i += 3) {
+            submit(clipVerts[indices[i]], clipVerts[indices[i + 1]], clipVerts[indices[i + 2]]);
+        }
+    }
+
+    // One triangle in world space
+    void drawTriangle(const Vec4& p0, const Vec4& p1, const Vec4& p2,
+                      const Color& c0, const Color& c1, const Color& c2) {
+        float rgb[9] = {c0.r, c0.g, c0.b, c1.r, c1.g, c1.b, c2.r, c2.g, c2.b};
+        submit(toClip(viewProj, p0, rgb), toClip(viewProj, p1, rgb + 3), toClip(viewProj, p2, rgb + 6));
+    }
+
+    // Line strip in world space, one colour, width in pixels
+    void drawLineStrip(const Vec4* points, int count, const Color& color, float width) {
+        float rgb[3] = {color.r, color.g, color.b};
+        int pixels = std::max(1, (int)(width + 0.5f));
+        for (int i = 0; i + 1 < count; i++) {
+            ClipVertex a = toClip(viewProj, points[i], rgb);
+            ClipVertex b = toClip(viewProj, points[i + 1], rgb);
+            if (!clipSegment(a, b)) continue;
+
+            LineSegment line;
+            line.a = toScreen(a);
+            line.b = toScreen(b);
+            line.width = pixels;
+            lines.push_back(line);
+        }
+    }
+
+    // Clear and rasterize every tile in parallel, then draw the lines
+    void end() {
+        TileJob tileJob(this);
+        pool->parallelFor(tilesX * tilesY, tileJob);
+        for (size_t i = 0; i < lines.size(); i++) rasterLine(lines[i]);
+    }
+
+private:
+    struct ClipVertex {
+        float x, y, z, w;
+        float r, g, b;
+    };
+
+    // Screen-space triangle: attributes as planes a*x + b*y + c over pixels
+    struct Plane {
+        float a, b, c;
+        float at(float x, float y) const { return a * x + b * y + c; }
+    };
+    struct Triangle {
+        Plane edge[3];              // >= 0 inside
+        Plane depth, invW, rw, gw, bw;
+        int minX, minY, maxX, maxY;
+    };
+
+    struct ScreenVertex {
+        float x, y, z;              // Pixels; depth in [0, 1]
+        float r, g, b;
+    };
+    struct LineSegment {
+        ScreenVertex a, b;
+        int width;
+    };
+
+    struct TileJob {
+        SoftRasterizer* raster;
+        explicit TileJob(SoftRasterizer* r) : raster(r) {}
+        void operator()(int tile) { raster->rasterTile(tile); }
+    };
+
+    WorkerPool* pool;
+    Framebuffer* target;
+    Matrix4x4 viewProj;
+    int tilesX, tilesY;
+    Color fogColor;
+    float fogDensity;
+    uint32_t clearValue;
+
+    std::vector<ClipVertex> clipVerts;
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<int> > bins;    // Triangle ids per tile
+    std::vector<LineSegment> lines;
+
+    ClipVertex toClip(const Matrix4x4& m, const Vec4& p, const float* rgb) const {
+        ClipVertex v;
+        v.x = m.m[0][0] * p.x + m.m[1][0] * p.y + m.m[2][0] * p.z + m.m[3][0];
+        v.y = m.m[0][1] * p.x + m.m[1][1] * p.y + m.m[2][1] * p.z + m.m[3][1];
+        v.z = m.m[0][2] * p.x + m.m[1][2] * p.y + m.m[2][2] * p.z + m.m[3][2];
+        v.w = m.m[0][3] * p.x + m.m[1][3] * p.y + m.m[2][3] * p.z + m.m[3][3];
+
+        // GL_EXP fog by eye distance (w = -eye z for a perspective projection)
+        float f = fogDensity > 0 ? std::exp(-fogDensity * std::fabs(v.w)) : 1.0f;
+        v.r = fogColor.r + (rgb[0] - fogColor.r) * f;
+        v.g = fogColor.g + (rgb[1] - fogColor.g) * f;
+        v.b = fogColor.b + (rgb[2] - fogColor.b) * f;
+        return v;
+    }
+
+    static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+        ClipVertex v;
+        v.x = a.x + (b.x - a.x) * t;
+        v.y = a.y + (b.y - a.y) * t;
+        v.z = a.z + (b.z - a.z) * t;
+        v.w = a.w + (b.w - a.w) * t;
+        v.r = a.r + (b.r - a.r) * t;
+        v.g = a.g + (b.g - a.g) * t;
+        v.b = a.b + (b.b - a.b) * t;
+        return v;
+    }
+
+    // Reject, clip against the near plane (z >= -w) and hand on as a fan
+    void submit(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c) {
+        trianglesSubmitted++;
+        const ClipVertex* in[3] = {&a, &b, &c};
+
+        // Trivially outside one frustum side
+        if (a.x > a.w && b.x > b.w && c.x > c.w) return;
+        if (a.x < -a.w && b.x < -b.w && c.x < -c.w) return;
+        if (a.y > a.w && b.y > b.w && c.y > c.w) return;
+        if (a.y < -a.w && b.y < -b.w && c.y < -c.w) return;
+        if (a.z > a.w && b.z > b.w && c.z > c.w) return;
+
+        ClipVertex poly[4];
+        int n = 0;
+        for (int i = 0; i < 3; i++) {
+            const ClipVertex& p = *in[i];
+            const ClipVertex& q = *in[(i + 1) % 3];
+            float dp = p.z + p.w, dq = q.z + q.w;
+            if (dp >= 0) poly[n++] = p;
+            if ((dp >= 0) != (dq >= 0)) poly[n++] = lerp(p, q, dp / (dp - dq));
+        }
+        for (int i = 1; i + 1 < n; i++) setup(poly[0], poly[i], poly[i + 1]);
+    }
+
+    // Signed distance of v inside frustum plane i (-x, +x, -y, +y, near, far)
+    static float planeDistance(const ClipVertex& v, int plane) {
+        float c = plane < 2 ? v.x : (plane < 4 ? v.y : v.z);
+        return (plane & 1) ? v.w - c : v.w + c;
+    }
+
+    // Cut a segment to the frustum (Liang-Barsky); false if nothing is left
+    static bool clipSegment(ClipVertex& a, ClipVertex& b) {
+        float t0 = 0.0f, t1 = 1.0f;
+        for (int plane = 0; plane < 6; plane++) {
+            float da = planeDistance(a, plane), db = planeDistance(b, plane);
+            if (da < 0 && db < 0) return false;
+            if (da < 0) t0 = std::max(t0, da / (da - db));
+            else if (db < 0) t1 = std::min(t1, da / (da - db));
+        }
+        if (t0 > t1) return false;
+        ClipVertex start = a;
+        a = lerp(start, b, t0);
+        b = lerp(start, b, t1);
+        return true;
+    }
+
+    ScreenVertex toScreen(const ClipVertex& v) const {
+        float iw = 1.0f / v.w;
+        ScreenVertex s;
+        s.x = std::min((float)target->width - 1, (v.x * iw * 0.5f + 0.5f) * target->width);
+        s.y = std::min((float)target->height - 1, (v.y * iw * 0.5f + 0.5f) * target->height);
+        s.z = v.z * iw * 0.5f + 0.5f;
+        s.r = v.r;
+        s.g = v.g;
+        s.b = v.b;
+        return s;
+    }
+
+    // Bresenham (CG.3 1.1) with depth and colour interpolated along the
+    // major axis, which advances one pixel per step
+    void rasterLine(const LineSegment& line) {
+        Framebuffer& fb = *target;
+        int x = std::max(0, (int)line.a.x), y = std::max(0, (int)line.a.y);
+        int x1 = std::max(0, (int)line.b.x), y1 = std::max(0, (int)line.b.y);
+        int dx = std::abs(x1 - x), dy = std::abs(y1 - y);
+        int sx = x < x1 ? 1 : -1, sy = y < y1 ? 1 : -1;
+        int err = dx - dy;
+        int steps = std::max(dx, dy);
+        bool xMajor = dx >= dy;
+        int lo = -(line.width - 1) / 2, hi = line.width / 2;
+
+        for (int step = 0; ; step++) {
+            float t = steps > 0 ? (float)step / steps : 0.0f;
+            float z = line.a.z + (line.b.z - line.a.z) * t;
+            uint32_t c = packColor(line.a.r + (line.b.r - line.a.r) * t,
+                                   line.a.g + (line.b.g - line.a.g) * t,
+                                   line.a.b + (line.b.b - line.a.b) * t);
+            for (int k = lo; k <= hi; k++) {
+                int px = xMajor ? x : x + k, py = xMajor ? y + k : y;
+                if (px < 0 || py < 0 || px >= fb.width || py >= fb.height) continue;
+                size_t p = (size_t)py * fb.width + px;
+                if (z < fb.depth[p] && z >= 0) {
+                    fb.depth[p] = z;
+                    fb.color[p] = c;
+                }
+            }
+
+            if (x == x1 && y == y1) break;
+            int e2 = 2 * err;
+            if (e2 > -dy) {
+                err -= dy;
+                x += sx;
+            }
+            if (e2 < dx) {
+                err += dx;
+                y += sy;
+            }
+        }
+    }
+
+    // Project, build attribute planes and bin into tiles
+    void setup(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2) {
+        const ClipVertex* v[3] = {&v0, &v1, &v2};
+        float sx[3], sy[3], sz[3], iw[3];
+        for (int i = 0; i < 3; i++) {
+            iw[i] = 1.0f / v[i]->w;
+            sx[i] = (v[i]->x * iw[i] * 0.5f + 0.5f) * target->width;
+            sy[i] = (v[i]->y * iw[i] * 0.5f + 0.5f) * target->height;
+            sz[i] = v[i]->z * iw[i] * 0.5f + 0.5f;
+        }
+
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if (std::fabs(area) < 1e-6f) return;
+
+        Triangle t;
+        t.minX = std::max(0, (int)std::floor(std::min(sx[0], std::min(sx[1], sx[2]))));
+        t.minY = std::max(0, (int)std::floor(std::min(sy[0], std::min(sy[1], sy[2]))));
+        t.maxX = std::min(target->width - 1, (int)std::ceil(std::max(sx[0], std::max(sx[1], sx[2]))));
+        t.maxY = std::min(target->height - 1, (int)std::ceil(std::max(sy[0], std::max(sy[1], sy[2]))));
+        if (t.minX > t.maxX || t.minY > t.maxY) return;
+
+        // Edge i is opposite vertex i; its value / area is vertex i's weight
+        float inv = 1.0f / area;
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3, k = (i + 2) % 3;
+            t.edge[i].a = (sy[j] - sy[k]) * inv;
+            t.edge[i].b = (sx[k] - sx[j]) * inv;
+            t.edge[i].c = (sx[j] * sy[k] - sx[k] * sy[j]) * inv;
+        }
+        float r[3], g[3], b[3];
+        for (int i = 0; i < 3; i++) {
+            r[i] = v[i]->r * iw[i];
+            g[i] = v[i]->g * iw[i];
+            b[i] = v[i]->b * iw[i];
+        }
+        t.depth = attributePlane(t, sz);
+        t.invW = attributePlane(t, iw);
+        t.rw = attributePlane(t, r);
+        t.gw = attributePlane(t, g);
+        t.bw = attributePlane(t, b);
+
+        int id = (int)triangles.size();
+        triangles.push_back(t);
+        trianglesBinned++;
+        int tx0 = t.minX / RASTER_TILE, tx1 = t.maxX / RASTER_TILE;
+        int ty0 = t.minY / RASTER_TILE, ty1 = t.maxY / RASTER_TILE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) bins[ty * tilesX + tx].push_back(id);
+        }
+    }
+
+    // Plane through the three vertex values, weighted by the edge functions
+    static Plane attributePlane(const Triangle& t, const float value[3]) {
+        Plane p;
+        p.a = t.edge[0].a * value[0] + t.edge[1].a * value[1] + t.edge[2].a * value[2];
+        p.b = t.edge[0].b * value[0] + t.edge[1].b * value[1] + t.edge[2].b * value[2];
+        p.c = t.edge[0].c * value[0] + t.edge[1].c * value[1] + t.edge[2].c * value[2];
+        return p;
+    }
+
+    void rasterTile(int tile) {
+        Framebuffer& fb = *target;
+        int x0 = (tile % tilesX) * RASTER_TILE, y0 = (tile / tilesX) * RASTER_TILE;
+        int x1 = std::min(fb.width, x0 + RASTER_TILE) - 1;
+        int y1 = std::min(fb.height, y0 + RASTER_TILE) - 1;
+
+        for (int y = y0; y <= y1; y++) {
+            std::fill(&fb.color[(size_t)y * fb.width + x0], &fb.color[(size_t)y * fb.width + x1] + 1, clearValue);
+            std::fill(&fb.depth[(size_t)y * fb.width + x0], &fb.depth[(size_t)y * fb.width + x1] + 1, 1.0f);
+        }
+
+        const std::vector<int>& bin = bins[tile];
+        for (size_t i = 0; i < bin.size(); i++) {
+            const Triangle& t = triangles[bin[i]];
+            int minX = std::max(x0, t.minX), maxX = std::min(x1, t.maxX);
+            int minY = std::max(y0, t.minY), maxY = std::min(y1, t.maxY);
+
+            for (int y = minY; y <= maxY; y++) {
+                float py = y + 0.5f, px = minX + 0.5f;
+                float e0 = t.edge[0].at(px, py), e1 = t.edge[1].at(px, py), e2 = t.edge[2].at(px, py);
+                float z = t.depth.at(px, py), w = t.invW.at(px, py);
+                float r = t.rw.at(px, py), g = t.gw.at(px, py), b = t.bw.at(px, py);
+                uint32_t* color = &fb.color[(size_t)y * fb.width];
+                float* depth = &fb.depth[(size_t)y * fb.width];
+
+                for (int x = minX; x <= maxX; x++) {
+                    if (e0 >= 0 && e1 >= 0 && e2 >= 0 && z < depth[x] && z >= 0) {
+                        depth[x] = z;
+                        float s = 1.0f / w;
+                        color[x] = packColor(r * s, g * s, b * s);
+                    }
+                    e0 += t.edge[0].a; e1 += t.edge[1].a; e2 += t.edge[2].a;
+                    z += t.depth.a; w += t.invW.a;
+                    r += t.rw.a; g += t.gw.a; b += t.bw.a;
+                }
+            }
+        }
+    }
+};
+
+#endif // SOFTRASTER_H
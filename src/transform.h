@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Transform Hierarchy Header
+ *
+ * Small scene graph for multi-part objects:
+ * - Nodes keep a cached local matrix and a cached world matrix
+ * - setLocal() only flags the node; update() recomputes world matrices for
+ *   flagged nodes and for children of nodes that changed this update
+ * - Static children of a static parent are multiplied once, on the first
+ *   update, and never again
+ *
+ * Nodes live in one flat array with parents before children, so the whole
+ * hierarchy copies by value (entities sit in std::vector).
+ ******************************************************************************/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "matrix.h"
+
+#include <vector>
+
+class TransformHierarchy {
+public:
+    TransformHierarchy() : multiplies(0) {}
+
+    // Add a node under parent (-1 = root); parent must already exist
+    int addNode(int parent, const Matrix4x4& local) {
+        Node n;
+        n.parent = parent;
+        n.local = local;
+        n.dirty = true;
+        n.changed = false;
+        nodes.push_back(n);
+        return (int)nodes.size() - 1;
+    }
+
+    void setLocal(int node, const Matrix4x4& local) {
+        nodes[node].local = local;
+        nodes[node].dirty = true;
+    }
+
+    const Matrix4x4& local(int node) const { return nodes[node].local; }
+    const Matrix4x4& world(int node) const { return nodes[node].world; }
+    int size() const { return (int)nodes.size(); }
+
+    // Matrix products done by the last update()
+    int lastMultiplies() const { return multiplies; }
+
+    // Refresh world matrices of dirty nodes and their descendants
+    void update() {
+        multiplies = 0;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            Node& n = nodes[i];
+            bool parentChanged = n.parent >= 0 && nodes[n.parent].changed;
+            n.changed = n.dirty || parentChanged;
+            if (!n.changed) continue;
+
+            if (n.parent >= 0) {
+                n.world = nodes[n.parent].world * n.local;
+                multiplies++;
+            } else {
+                n.world = n.local;
+            }
+            n.dirty = false;
+        }
+    }
+
+private:
+    struct Node {
+        Matrix4x4 local;
+        Matrix4x4 world;
+        int parent;
+        bool dirty;         // Local matrix changed since the last update
+        bool changed;       // World matrix was recomputed in the last update
+    };
+
+    std::vector<Node> nodes;
+    int multiplies;
+};
+
+#endif // TRANSFORM_H
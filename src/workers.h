@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * THE SHIFTING MAZE - Worker Pool Header
+ *
+ * Persistent threads for data-parallel frame work:
+ * - parallelFor(count, job) runs job(i) for i in [0, count); threads claim
+ *   indices from a shared counter, so uneven jobs balance themselves
+ * - The calling thread works too and returns when every index is done
+ * - Threads sleep on a condition variable between calls (no spinning)
+ ******************************************************************************/
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class WorkerPool {
+public:
+    // threads = total including the caller; 0 = one per hardware thread
+    explicit WorkerPool(int threads = 0)
+        : job(NULL), context(NULL), jobCount(0), next(0), busy(0), generation(0), quit(false) {
+        if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+        if (threads <= 0) threads = 1;
+        for (int i = 1; i < threads; i++) {
+            workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+    }
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    // Run f(i) for every i in [0, count) across all threads
+    template <typename F>
+    void parallelFor(int count, F& f) {
+        if (count <= 0) return;
+        if (workers.empty() || count == 1) {
+            for (int i = 0; i < count; i++) f(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &trampoline<F>;
+            context = &f;
+            jobCount = count;
+            next = 0;
+            busy = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (busy > 0) done.wait(lock);
+    }
+
+private:
+    typedef void (*JobFn)(void* context, int index);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    JobFn job;
+    void* context;
+    int jobCount;
+    std::atomic<int> next;
+    int busy;                   // Workers still in the current call
+    unsigned int generation;    // Bumped per call so workers see new work
+    bool quit;
+
+    WorkerPool(const WorkerPool&);
+    WorkerPool& operator=(const WorkerPool&);
+
+    template <typename F>
+    static void trampoline(void* context, int index) { (*static_cast<F*>(context))(index); }
+
+    void work() {
+        for (int i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1)) {
+            job(context, i);
+        }
+    }
+
+    void workerLoop() {
+        unsigned int seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            while (!quit && generation == seen) wake.wait(lock);
+            if (quit) return;
+            seen = generation;
+
+            lock.unlock();
+            work();
+            lock.lock();
+            if (--busy == 0) done.notify_one();
+        }
+    }
+};
+
+#endif // WORKERS_H